@@ -0,0 +1,430 @@
+// Decompression benchmark
+// Decodes every Nemesis and Kosinski asset through the game's decoders, and reports the
+// throughput and a checksum of the output of each, so decoder changes can be checked for
+// both speed and identical output
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "Nemesis.h"
+#include "Kosinski.h"
+
+#include "Backend/VDP.h"
+
+// Assets
+static const char *nemesis_assets[] = {
+	"Art/BigFlash",
+	"Art/Bumper",
+	"Art/BuzzBomber",
+	"Art/Chopper",
+	"Art/Crabmeat",
+	"Art/CreditsFont",
+	"Art/Explosion",
+	"Art/GHZ1",
+	"Art/GHZ2",
+	"Art/GHZBall",
+	"Art/GHZBridge",
+	"Art/GHZLog",
+	"Art/GHZRock",
+	"Art/GHZStalk",
+	"Art/GHZSwing",
+	"Art/GHZWall1",
+	"Art/GHZWall2",
+	"Art/GameOver",
+	"Art/HUD",
+	"Art/HUDLife",
+	"Art/HiddenBonus",
+	"Art/Invincibility",
+	"Art/JapaneseCredits",
+	"Art/LZ",
+	"Art/Lamppost",
+	"Art/MZ",
+	"Art/Monitor",
+	"Art/Motobug",
+	"Art/Newtron",
+	"Art/Points",
+	"Art/Ring",
+	"Art/SBZ",
+	"Art/SLZ",
+	"Art/SSBack",
+	"Art/SSChecker",
+	"Art/SSClouds",
+	"Art/SSEmerald",
+	"Art/SSGhost",
+	"Art/SSGlass",
+	"Art/SSGoal",
+	"Art/SSLife",
+	"Art/SSResultEmerald",
+	"Art/SSRotate",
+	"Art/SSSpeed",
+	"Art/SSTwinkle",
+	"Art/SSWall",
+	"Art/SSWarp",
+	"Art/SSZone1",
+	"Art/SSZone2",
+	"Art/SSZone3",
+	"Art/SSZone4",
+	"Art/SSZone5",
+	"Art/SSZone6",
+	"Art/SYZ",
+	"Art/SegaREV00",
+	"Art/SegaREV01",
+	"Art/Shield",
+	"Art/Signpost",
+	"Art/Spikes",
+	"Art/SpringH",
+	"Art/SpringV",
+	"Art/TitleCard",
+	"Art/TitleFG",
+	"Art/TitleSonic",
+	"Art/TitleTM",
+	"SSRG/ArtLink",
+	"SSRG/ArtMain",
+	"SSRG/ArtSonic",
+	"SSRG/ArtSquare",
+};
+
+static const char *kosinski_assets[] = {
+	"Map256/GHZ",
+	"Map256/LZ",
+	"Map256/MZREV00",
+	"Map256/MZREV01",
+	"Map256/SBZREV00",
+	"Map256/SBZREV01",
+	"Map256/SLZ",
+	"Map256/SYZ",
+	"SSRG/MapLink",
+	"SSRG/MapMain",
+	"SSRG/MapSquare",
+};
+
+#define ASSET_PAD 0x10 // Zero padding after each asset, as decoders may read a little ahead
+
+// Decoders
+typedef enum
+{
+	Codec_NemesisRAM,
+	Codec_NemesisVRAM,
+	Codec_Kosinski,
+	Codec_Num,
+} Codec;
+
+static const char *codec_name[Codec_Num] = {
+	"nemesis-ram",
+	"nemesis-vram",
+	"kosinski",
+};
+
+static uint8_t output[0x20000];
+static size_t output_pos;
+
+// NemDec writes here rather than to a VDP
+void VDP_WriteVRAM(const uint8_t *data, size_t len)
+{
+	if (output_pos + len > sizeof(output))
+	{
+		fprintf(stderr, "VRAM output overflowed\n");
+		exit(1);
+	}
+	memcpy(output + output_pos, data, len);
+	output_pos += len;
+}
+
+static void Decode(Codec codec, const uint8_t *data)
+{
+	switch (codec)
+	{
+		case Codec_NemesisRAM:
+			NemDecToRAM(data, output);
+			break;
+		case Codec_NemesisVRAM:
+			output_pos = 0;
+			NemDec(data);
+			break;
+		case Codec_Kosinski:
+			KosDec(data, output);
+			break;
+		default:
+			break;
+	}
+}
+
+// Returns the number of bytes the asset decodes to, or 0 if it's malformed
+static size_t DecodedSize(Codec codec, const uint8_t *data, size_t len)
+{
+	switch (codec)
+	{
+		case Codec_NemesisRAM:
+		case Codec_NemesisVRAM:
+			if (len < 2)
+				return 0;
+			return (size_t)(((data[0] << 8) | data[1]) & 0x7FFF) * 0x20;
+		case Codec_Kosinski:
+		{
+			uint8_t *end = KosDecSafe(data, len, output, sizeof(output));
+			return (end != NULL) ? (size_t)(end - output) : 0;
+		}
+		default:
+			return 0;
+	}
+}
+
+// Timing
+static double GetTime(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (double)now.tv_sec + (double)now.tv_nsec / 1000000000.0;
+}
+
+static uint32_t Checksum(const uint8_t *data, size_t len)
+{
+	// FNV-1a
+	uint32_t hash = 0x811C9DC5;
+	for (size_t i = 0; i < len; i++)
+		hash = (hash ^ data[i]) * 0x01000193;
+	return hash;
+}
+
+// Results
+typedef enum
+{
+	Format_Text,
+	Format_CSV,
+	Format_JSON,
+} Format;
+
+typedef struct
+{
+	Codec codec;
+	const char *asset;
+	size_t in_size, out_size;
+	unsigned long iterations;
+	double seconds; // Best time for a single decode
+	uint32_t checksum;
+} Result;
+
+static void PrintResult(Format format, const Result *result, bool first)
+{
+	double mbs = (double)result->out_size / result->seconds / 1000000.0;
+	double nsb = result->seconds * 1000000000.0 / (double)result->out_size;
+	
+	switch (format)
+	{
+		case Format_Text:
+			printf("%-13s %-22s %7zu %7zu %9.2f %8.3f %08lx\n", codec_name[result->codec], result->asset, result->in_size, result->out_size, mbs, nsb, (unsigned long)result->checksum);
+			break;
+		case Format_CSV:
+			printf("%s,%s,%zu,%zu,%lu,%.3f,%.4f,%08lx\n", codec_name[result->codec], result->asset, result->in_size, result->out_size, result->iterations, mbs, nsb, (unsigned long)result->checksum);
+			break;
+		case Format_JSON:
+			printf("%s\n\t{\"codec\": \"%s\", \"asset\": \"%s\", \"input_bytes\": %zu, \"output_bytes\": %zu, \"iterations\": %lu, \"mb_per_s\": %.3f, \"ns_per_byte\": %.4f, \"checksum\": \"%08lx\"}",
+				first ? "[" : ",", codec_name[result->codec], result->asset, result->in_size, result->out_size, result->iterations, mbs, nsb, (unsigned long)result->checksum);
+			break;
+	}
+}
+
+static void PrintHeader(Format format)
+{
+	switch (format)
+	{
+		case Format_Text:
+			printf("%-13s %-22s %7s %7s %9s %8s %-8s\n", "codec", "asset", "in", "out", "MB/s", "ns/byte", "checksum");
+			break;
+		case Format_CSV:
+			printf("codec,asset,input_bytes,output_bytes,iterations,mb_per_s,ns_per_byte,checksum\n");
+			break;
+		case Format_JSON:
+			break;
+	}
+}
+
+static void PrintTotals(Format format, bool any, const size_t *out_size, const double *seconds)
+{
+	switch (format)
+	{
+		case Format_Text:
+			printf("\n");
+			for (int i = 0; i < Codec_Num; i++)
+				if (seconds[i] > 0.0)
+					printf("%-13s %-22s %7s %7zu %9.2f %8.3f\n", codec_name[i], "(total)", "", out_size[i], (double)out_size[i] / seconds[i] / 1000000.0, seconds[i] * 1000000000.0 / (double)out_size[i]);
+			break;
+		case Format_CSV:
+			break;
+		case Format_JSON:
+			printf(any ? "\n]\n" : "[]\n");
+			break;
+	}
+}
+
+// Entry point
+static void Usage(const char *name)
+{
+	fprintf(stderr,
+		"usage: %s [-d res_dir] [-f text|csv|json] [-t ms] [-r rounds]\n"
+		"  -d  directory containing the assets (default " SCP_RES_DIR ")\n"
+		"  -f  output format (default text)\n"
+		"  -t  minimum time of each timing round in milliseconds (default 20)\n"
+		"  -r  number of timing rounds, of which the fastest is reported (default 5)\n",
+		name);
+}
+
+int main(int argc, char *argv[])
+{
+	// Read arguments
+	const char *res_dir = SCP_RES_DIR;
+	Format format = Format_Text;
+	double round_time = 0.02;
+	int rounds = 5;
+	
+	for (int i = 1; i < argc; i++)
+	{
+		if (i + 1 >= argc)
+		{
+			Usage(argv[0]);
+			return 1;
+		}
+		
+		if (!strcmp(argv[i], "-d"))
+		{
+			res_dir = argv[++i];
+		}
+		else if (!strcmp(argv[i], "-f"))
+		{
+			i++;
+			if (!strcmp(argv[i], "text"))
+				format = Format_Text;
+			else if (!strcmp(argv[i], "csv"))
+				format = Format_CSV;
+			else if (!strcmp(argv[i], "json"))
+				format = Format_JSON;
+			else
+			{
+				Usage(argv[0]);
+				return 1;
+			}
+		}
+		else if (!strcmp(argv[i], "-t"))
+		{
+			round_time = atof(argv[++i]) / 1000.0;
+		}
+		else if (!strcmp(argv[i], "-r"))
+		{
+			rounds = atoi(argv[++i]);
+			if (rounds < 1)
+				rounds = 1;
+		}
+		else
+		{
+			Usage(argv[0]);
+			return 1;
+		}
+	}
+	
+	// Run benchmarks
+	static const struct
+	{
+		Codec codec;
+		const char **assets;
+		size_t num;
+	} runs[] = {
+		{Codec_NemesisRAM,  nemesis_assets,  sizeof(nemesis_assets) / sizeof(*nemesis_assets)},
+		{Codec_NemesisVRAM, nemesis_assets,  sizeof(nemesis_assets) / sizeof(*nemesis_assets)},
+		{Codec_Kosinski,    kosinski_assets, sizeof(kosinski_assets) / sizeof(*kosinski_assets)},
+	};
+	
+	size_t total_out[Codec_Num] = {0};
+	double total_seconds[Codec_Num] = {0.0};
+	bool any = false;
+	int failed = 0;
+	
+	PrintHeader(format);
+	
+	for (size_t r = 0; r < sizeof(runs) / sizeof(*runs); r++)
+	{
+		for (size_t a = 0; a < runs[r].num; a++)
+		{
+			const char *asset = runs[r].assets[a];
+			
+			// Read asset
+			char path[1024];
+			snprintf(path, sizeof(path), "%s/%s", res_dir, asset);
+			
+			FILE *fp = fopen(path, "rb");
+			if (fp == NULL)
+			{
+				fprintf(stderr, "Failed to open %s\n", path);
+				failed++;
+				continue;
+			}
+			
+			fseek(fp, 0, SEEK_END);
+			long in_size = ftell(fp);
+			fseek(fp, 0, SEEK_SET);
+			
+			uint8_t *data = calloc((size_t)in_size + ASSET_PAD, 1);
+			if (data == NULL || fread(data, 1, (size_t)in_size, fp) != (size_t)in_size)
+			{
+				fprintf(stderr, "Failed to read %s\n", path);
+				fclose(fp);
+				free(data);
+				failed++;
+				continue;
+			}
+			fclose(fp);
+			
+			// Check the asset decodes within the output buffer
+			size_t out_size = DecodedSize(runs[r].codec, data, (size_t)in_size);
+			if (out_size == 0 || out_size > sizeof(output))
+			{
+				fprintf(stderr, "Failed to decode %s\n", path);
+				free(data);
+				failed++;
+				continue;
+			}
+			
+			// Time rounds of repeated decodes, keeping the fastest
+			Result result;
+			result.codec = runs[r].codec;
+			result.asset = asset;
+			result.in_size = (size_t)in_size;
+			result.out_size = out_size;
+			result.iterations = 0;
+			result.seconds = 0.0;
+			
+			for (int i = 0; i < rounds; i++)
+			{
+				unsigned long iterations = 0;
+				double start = GetTime(), elapsed;
+				do
+				{
+					Decode(runs[r].codec, data);
+					iterations++;
+				} while ((elapsed = GetTime() - start) < round_time);
+				
+				double seconds = elapsed / (double)iterations;
+				if (i == 0 || seconds < result.seconds)
+					result.seconds = seconds;
+				result.iterations += iterations;
+			}
+			
+			result.checksum = Checksum(output, out_size);
+			free(data);
+			
+			PrintResult(format, &result, !any);
+			any = true;
+			
+			total_out[result.codec] += out_size;
+			total_seconds[result.codec] += result.seconds;
+		}
+	}
+	
+	PrintTotals(format, any, total_out, total_seconds);
+	
+	return failed ? 1 : 0;
+}
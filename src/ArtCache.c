@@ -0,0 +1,228 @@
+#include "ArtCache.h"
+
+#include "Nemesis.h"
+
+#include "Backend/VDP.h"
+
+#include <string.h>
+
+// Art cache state
+static ArtCache_Stats art_cache_stats;
+
+#if SCP_ART_CACHE_SIZE != 0
+
+typedef struct
+{
+	const uint8_t *art; // Compressed art this entry was decoded from
+	size_t pos, size;   // Location of the decoded art in the arena
+	uint32_t last_use;  // Use stamp, for finding the least recently used entry
+	bool complete;      // Entry has been entirely filled
+	bool locked;        // Entry is in use, and mustn't be evicted
+} ArtCacheEntry;
+
+static ALIGNED4 uint8_t art_cache_arena[SCP_ART_CACHE_SIZE];
+
+// Entries are kept in the order of their data in the arena, which is kept packed
+static ArtCacheEntry art_cache_entry[ART_CACHE_ENTRIES];
+static size_t art_cache_entries;
+static uint32_t art_cache_use;
+
+// Internal functions
+static ArtCacheEntry *ArtCache_GetEntry(const uint8_t *art)
+{
+	for (size_t i = 0; i < art_cache_entries; i++)
+		if (art_cache_entry[i].art == art)
+			return &art_cache_entry[i];
+	return NULL;
+}
+
+static void ArtCache_Remove(size_t index)
+{
+	// Move the data and entries following the removed entry down
+	ArtCacheEntry *entry = &art_cache_entry[index];
+	size_t end = art_cache_stats.used;
+	
+	memmove(&art_cache_arena[entry->pos], &art_cache_arena[entry->pos + entry->size], end - (entry->pos + entry->size));
+	for (size_t i = index + 1; i < art_cache_entries; i++)
+		art_cache_entry[i].pos -= entry->size;
+	
+	art_cache_stats.used -= entry->size;
+	memmove(entry, entry + 1, (art_cache_entries - index - 1) * sizeof(ArtCacheEntry));
+	art_cache_entries--;
+}
+
+static bool ArtCache_Evict(size_t size)
+{
+	// Evict the least recently used unlocked entries until there's enough space
+	while (art_cache_entries == ART_CACHE_ENTRIES || SCP_ART_CACHE_SIZE - art_cache_stats.used < size)
+	{
+		size_t lru = art_cache_entries;
+		for (size_t i = 0; i < art_cache_entries; i++)
+			if (!art_cache_entry[i].locked && (lru == art_cache_entries || (uint32_t)(art_cache_use - art_cache_entry[i].last_use) > (uint32_t)(art_cache_use - art_cache_entry[lru].last_use)))
+				lru = i;
+		if (lru == art_cache_entries)
+			return false;
+		
+		ArtCache_Remove(lru);
+		art_cache_stats.evictions++;
+	}
+	return true;
+}
+
+// Art cache interface
+uint8_t *ArtCache_Find(const uint8_t *art, bool partial)
+{
+	// Find entry
+	ArtCacheEntry *entry = ArtCache_GetEntry(art);
+	if (entry == NULL || (!partial && !entry->complete))
+	{
+		if (!partial)
+			art_cache_stats.misses++;
+		return NULL;
+	}
+	
+	if (!partial)
+		art_cache_stats.hits++;
+	entry->last_use = ++art_cache_use;
+	return &art_cache_arena[entry->pos];
+}
+
+uint8_t *ArtCache_Alloc(const uint8_t *art, size_t size)
+{
+	// Replace any previous entry for this art
+	ArtCacheEntry *entry = ArtCache_GetEntry(art);
+	if (entry != NULL)
+	{
+		if (entry->locked)
+			return NULL;
+		ArtCache_Remove(entry - art_cache_entry);
+	}
+	
+	// Make room for the entry, keeping the arena word aligned
+	size = (size + 3) & ~3;
+	if (size == 0 || size > SCP_ART_CACHE_SIZE || !ArtCache_Evict(size))
+		return NULL;
+	
+	// Push new entry, locked until it's filled
+	entry = &art_cache_entry[art_cache_entries++];
+	entry->art = art;
+	entry->pos = art_cache_stats.used;
+	entry->size = size;
+	entry->last_use = ++art_cache_use;
+	entry->complete = false;
+	entry->locked = true;
+	
+	art_cache_stats.used += size;
+	return &art_cache_arena[entry->pos];
+}
+
+void ArtCache_Lock(const uint8_t *art)
+{
+	ArtCacheEntry *entry = ArtCache_GetEntry(art);
+	if (entry != NULL)
+		entry->locked = true;
+}
+
+void ArtCache_Release(const uint8_t *art, bool valid)
+{
+	// Unlock entry, or remove it if it wasn't filled
+	ArtCacheEntry *entry = ArtCache_GetEntry(art);
+	if (entry == NULL)
+		return;
+	
+	if (valid)
+	{
+		entry->complete = true;
+		entry->locked = false;
+	}
+	else
+	{
+		ArtCache_Remove(entry - art_cache_entry);
+	}
+}
+
+void ArtCache_Clear()
+{
+	// Remove every unlocked entry
+	for (size_t i = art_cache_entries; i-- != 0;)
+		if (!art_cache_entry[i].locked)
+			ArtCache_Remove(i);
+}
+
+void ArtCache_Flush()
+{
+	// Remove every entry
+	art_cache_entries = 0;
+	art_cache_stats.used = 0;
+}
+
+#else
+
+// Art cache interface
+uint8_t *ArtCache_Find(const uint8_t *art, bool partial)
+{
+	(void)art;
+	if (!partial)
+		art_cache_stats.misses++;
+	return NULL;
+}
+
+uint8_t *ArtCache_Alloc(const uint8_t *art, size_t size)
+{
+	(void)art;
+	(void)size;
+	return NULL;
+}
+
+void ArtCache_Lock(const uint8_t *art)
+{
+	(void)art;
+}
+
+void ArtCache_Release(const uint8_t *art, bool valid)
+{
+	(void)art;
+	(void)valid;
+}
+
+void ArtCache_Clear()
+{
+
+}
+
+void ArtCache_Flush()
+{
+
+}
+
+#endif
+
+const ArtCache_Stats *ArtCache_GetStats()
+{
+	return &art_cache_stats;
+}
+
+void ArtCache_NemDec(const uint8_t *art)
+{
+	// Decompress art into the cache if it isn't already there
+	size_t size = NEM_SIZE(art);
+	
+	const uint8_t *data = ArtCache_Find(art, false);
+	if (data == NULL)
+	{
+		uint8_t *fill = ArtCache_Alloc(art, size);
+		if (fill == NULL)
+		{
+			// Couldn't fit in the cache, decompress straight to VRAM
+			NemDec(art);
+			return;
+		}
+		
+		NemDecToRAM(art, fill);
+		ArtCache_Release(art, true);
+		data = fill;
+	}
+	
+	// Copy art to VRAM
+	VDP_WriteVRAM(data, size);
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+// Art cache
+// Keeps decompressed copies of Nemesis art, keyed by the compressed art's address, so art
+// loaded again (such as level art on every restart) can be copied straight to VRAM.
+// The least recently used entries are evicted to stay within SCP_ART_CACHE_SIZE bytes;
+// a size of 0 disables the cache.
+#ifndef SCP_ART_CACHE_SIZE
+	#define SCP_ART_CACHE_SIZE 0x20000
+#endif
+
+#define ART_CACHE_ENTRIES 32
+
+// Decompressed size of Nemesis art
+#define NEM_SIZE(art) ((((art)[0] << 8 | (art)[1]) & 0x7FFF) * 0x20)
+
+// Art cache statistics
+typedef struct
+{
+	size_t hits;      // Lookups of complete entries that were found
+	size_t misses;    // Lookups of complete entries that weren't found
+	size_t evictions; // Entries evicted to make room for others
+	size_t used;      // Bytes currently in use
+} ArtCache_Stats;
+
+// Art cache interface
+// Pointers to entry data are only valid until the next call to ArtCache_Alloc, as
+// entries are moved when others are evicted. Statistics only count lookups of
+// complete entries (when 'partial' isn't set). ArtCache_Flush also removes locked
+// entries, for when whatever locked them has been thrown away
+uint8_t *ArtCache_Find(const uint8_t *art, bool partial);
+uint8_t *ArtCache_Alloc(const uint8_t *art, size_t size);
+void ArtCache_Lock(const uint8_t *art);
+void ArtCache_Release(const uint8_t *art, bool valid);
+void ArtCache_Clear();
+void ArtCache_Flush();
+const ArtCache_Stats *ArtCache_GetStats();
+
+void ArtCache_NemDec(const uint8_t *art);
@@ -0,0 +1,9 @@
+#pragma once
+
+#include <stdint.h>
+
+// Host backend interface
+// Framebuffer is SCREEN_WIDTH x SCREEN_HEIGHT packed RGB888, updated by every VDP_Render
+const uint8_t *VDP_GetFramebuffer();
+// VRAM is VRAM_SIZE bytes, with the planes in host byte order
+const uint8_t *VDP_GetVRAM();
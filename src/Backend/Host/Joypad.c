@@ -0,0 +1,18 @@
+#include "Backend/Joypad.h"
+
+// Joypad interface
+// The host build has no input devices, so both pads always read as released
+void Joypad_Init()
+{
+	
+}
+
+uint8_t Joypad_GetState1()
+{
+	return 0;
+}
+
+uint8_t Joypad_GetState2()
+{
+	return 0;
+}
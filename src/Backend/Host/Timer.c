@@ -0,0 +1,49 @@
+#include "Backend/Timer.h"
+
+#include <time.h>
+
+// Timer constants
+#define TIMER_RATE 100
+
+// Timer state
+static struct timespec timer_start;
+
+// Timer interface
+void Timer_Init(void)
+{
+	clock_gettime(CLOCK_MONOTONIC, &timer_start);
+}
+
+uint32_t Timer_GetTicks(void)
+{
+	// Get time since initialization
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	
+	uint64_t ns = (uint64_t)(now.tv_sec - timer_start.tv_sec) * 1000000000 + (uint64_t)now.tv_nsec - (uint64_t)timer_start.tv_nsec;
+	return (uint32_t)(ns / (1000000000 / TIMER_RATE));
+}
+
+uint32_t Timer_GetMicros(void)
+{
+	// Get time since initialization
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	
+	uint64_t ns = (uint64_t)(now.tv_sec - timer_start.tv_sec) * 1000000000 + (uint64_t)now.tv_nsec - (uint64_t)timer_start.tv_nsec;
+	return (uint32_t)(ns / 1000);
+}
+
+uint32_t Timer_GetCounter(void)
+{
+	// Count nanoseconds
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	
+	return (uint32_t)((uint64_t)now.tv_sec * 1000000000 + (uint64_t)now.tv_nsec);
+}
+
+uint32_t Timer_GetCounterRate(void)
+{
+	return 1000000000;
+}
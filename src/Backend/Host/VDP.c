@@ -0,0 +1,624 @@
+#include "Backend/VDP.h"
+#include "Host.h"
+
+#include "Backend/MegaDrive.h"
+#include "Backend/Timer.h"
+#include "Backend/Tile.h"
+#include "Backend/Profile.h"
+#include "Backend/State.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+// VDP constants
+#define VDP_DIRTY_SIZE 0x200
+#define VDP_LINE_PAD 8
+
+#define VDP_PIXEL_PRIORITY 0x80
+#define VDP_PIXEL_COLOUR   0x3F
+#define VDP_PIXEL_INDEX    0x0F
+
+static const uint8_t VDP_COLLEVEL_8[] = {
+	0,
+	52,
+	87,
+	116,
+	144,
+	172,
+	206,
+	255
+};
+
+// Every 9-bit colour, indexed as 0bBBBGGGRRR
+#define VDP_MD_COLOURS 0x200
+#define VDP_COLOUR_INDEX(cv) ((((cv) & 0x00E) >> 1) | (((cv) & 0x0E0) >> 2) | (((cv) & 0xE00) >> 3))
+
+// VDP internal state
+static ALIGNED4 uint8_t vdp_vram[VRAM_SIZE];
+static ALIGNED16 uint8_t vdp_vram_8[VRAM_SIZE * 2];
+static uint8_t *vdp_vram_p;
+
+static uint8_t vdp_vram_dirty[VRAM_SIZE / VDP_DIRTY_SIZE];
+
+static uint16_t vdp_cram[16 * 4];
+static uint16_t *vdp_cram_p;
+
+static uint8_t vdp_colour_lut[VDP_MD_COLOURS][3];
+static uint8_t vdp_cram_fmt[COLOURS][3];
+static uint8_t vdp_cram_dirty[COLOURS];
+static bool vdp_cram_changed;
+
+static size_t vdp_plane_a_location, vdp_plane_b_location, vdp_sprite_location, vdp_hscroll_location;
+static size_t vdp_plane_w, vdp_plane_h, vdp_plane_size;
+static uint8_t vdp_background_colour;
+
+static int16_t vdp_vscroll_a, vdp_vscroll_b;
+
+static int16_t vdp_hint_pos;
+
+static MD_Vector vdp_hint, vdp_vint;
+
+// Rasterizer state
+typedef struct
+{
+	int16_t x, y;
+	uint8_t w, h;
+	uint16_t tile;
+	bool cut;
+} VDP_Sprite;
+
+static VDP_Sprite vdp_sprites[SPRITES];
+static size_t vdp_sprites_num;
+
+static uint8_t vdp_framebuffer[SCREEN_HEIGHT][SCREEN_WIDTH][3];
+
+static VDP_Stats vdp_stats;
+
+static unsigned int vdp_render_interval, vdp_render_count;
+
+static VDPSpriteLimit vdp_sprite_limit;
+static bool vdp_sprite_report;
+
+// Host state
+static unsigned long host_frame, host_frame_limit;
+
+static const char *host_capture;
+
+// Saved state
+static const State_Region vdp_state[] = {
+	STATE_REGION(vdp_vram),
+	STATE_REGION(vdp_vram_p),
+	STATE_REGION(vdp_cram),
+	STATE_REGION(vdp_cram_p),
+	STATE_REGION(vdp_plane_a_location),
+	STATE_REGION(vdp_plane_b_location),
+	STATE_REGION(vdp_sprite_location),
+	STATE_REGION(vdp_hscroll_location),
+	STATE_REGION(vdp_plane_w),
+	STATE_REGION(vdp_plane_h),
+	STATE_REGION(vdp_plane_size),
+	STATE_REGION(vdp_background_colour),
+	STATE_REGION(vdp_vscroll_a),
+	STATE_REGION(vdp_vscroll_b),
+	STATE_REGION(vdp_hint_pos),
+};
+
+static void VDP_LoadState()
+{
+	// Deconstruct all of VRAM and convert all of CRAM again
+	memset(vdp_vram_dirty, 1, sizeof(vdp_vram_dirty));
+	memset(vdp_cram_dirty, 1, sizeof(vdp_cram_dirty));
+	vdp_cram_changed = true;
+}
+
+// VDP interface
+int VDP_Init(const MD_Header *header)
+{
+	// Get frame limit
+	// SCP_FRAMES=n exits after n frames have been rendered, 0 or unset runs forever
+	const char *frames = getenv("SCP_FRAMES");
+	host_frame_limit = (frames != NULL) ? strtoul(frames, NULL, 0) : 0;
+	host_frame = 0;
+	
+	// Get capture path
+	// SCP_CAPTURE=prefix writes every rendered frame to prefix######.ppm
+	host_capture = getenv("SCP_CAPTURE");
+	
+	// Get render interval
+	// SCP_RENDER=n only rasterizes every nth frame, 0 never does
+	const char *render = getenv("SCP_RENDER");
+	vdp_render_interval = (render != NULL) ? strtoul(render, NULL, 0) : 1;
+	vdp_render_count = 0;
+	
+	// Get sprite limit
+	// SCP_SPRITE_LIMIT=1 enforces the per line limits, 0 doesn't, and either reports frames that go over them
+	const char *sprite_limit = getenv("SCP_SPRITE_LIMIT");
+	vdp_sprite_limit = (sprite_limit != NULL && strtoul(sprite_limit, NULL, 0) != 0) ? VDPSpriteLimit_Line : VDPSpriteLimit_None;
+	vdp_sprite_report = sprite_limit != NULL;
+	
+	// Initialize tile kernels
+	Tile_Init();
+	memset(vdp_vram_dirty, 1, sizeof(vdp_vram_dirty));
+	
+	// Build colour table
+	for (size_t i = 0; i < VDP_MD_COLOURS; i++)
+	{
+		vdp_colour_lut[i][0] = VDP_COLLEVEL_8[i & 7];
+		vdp_colour_lut[i][1] = VDP_COLLEVEL_8[(i >> 3) & 7];
+		vdp_colour_lut[i][2] = VDP_COLLEVEL_8[i >> 6];
+	}
+	memset(vdp_cram_dirty, 1, sizeof(vdp_cram_dirty));
+	vdp_cram_changed = true;
+	
+	// Initialize VDP state
+	vdp_plane_a_location = 0;
+	vdp_plane_b_location = 0;
+	vdp_sprite_location  = 0;
+	vdp_hscroll_location = 0;
+	vdp_plane_w = 32;
+	vdp_plane_h = 32;
+	vdp_background_colour = 0;
+	vdp_vscroll_a = 0;
+	vdp_vscroll_b = 0;
+	vdp_hint_pos = -1;
+	
+	vdp_hint = header->h_interrupt;
+	vdp_vint = header->v_interrupt;
+	
+	State_Register(vdp_state, sizeof(vdp_state) / sizeof(*vdp_state), VDP_LoadState);
+	
+	return 0;
+}
+
+void VDP_SeekVRAM(size_t offset)
+{
+	vdp_vram_p = vdp_vram + offset;
+}
+
+static void VDP_DirtyVRAM(size_t a, size_t b)
+{
+	// Dirty every block touched by the write
+	if (a == b)
+		return;
+	a /= VDP_DIRTY_SIZE;
+	b = (b - 1) / VDP_DIRTY_SIZE;
+	memset(vdp_vram_dirty + a, 1, b - a + 1);
+}
+
+void VDP_WriteVRAM(const uint8_t *data, size_t len)
+{
+	uint8_t *vdp_vram_start = vdp_vram_p;
+	memcpy(vdp_vram_start, data, len);
+	vdp_vram_p += len;
+	VDP_DirtyVRAM(vdp_vram_start - vdp_vram, vdp_vram_p - vdp_vram);
+}
+
+void VDP_WriteVRAMStrided(const uint8_t *data, size_t len, size_t count, size_t src_stride, size_t dst_stride)
+{
+	// Write rows, dirtying the whole span once
+	if (count == 0)
+		return;
+	uint8_t *vdp_vram_start = vdp_vram_p;
+	for (size_t i = 0; i < count; i++, data += src_stride, vdp_vram_p += dst_stride)
+		memcpy(vdp_vram_p, data, len);
+	VDP_DirtyVRAM(vdp_vram_start - vdp_vram, (vdp_vram_p - dst_stride + len) - vdp_vram);
+}
+
+void VDP_FillVRAM(uint8_t data, size_t len)
+{
+	uint8_t *vdp_vram_start = vdp_vram_p;
+	memset(vdp_vram_start, data, len);
+	vdp_vram_p += len;
+	VDP_DirtyVRAM(vdp_vram_start - vdp_vram, vdp_vram_p - vdp_vram);
+}
+
+void VDP_WritePlaneRect(size_t location, size_t x, size_t y, size_t w, size_t h, const uint16_t *data)
+{
+	// Split rectangle where it wraps around the plane
+	for (size_t j = 0; j < h;)
+	{
+		size_t py = (y + j) % vdp_plane_h;
+		size_t rh = vdp_plane_h - py;
+		if (rh > (h - j))
+			rh = h - j;
+		
+		for (size_t i = 0; i < w;)
+		{
+			size_t px = (x + i) % vdp_plane_w;
+			size_t rw = vdp_plane_w - px;
+			if (rw > (w - i))
+				rw = w - i;
+			
+			// Write piece
+			VDP_SeekVRAM(location + (((py * vdp_plane_w) + px) << 1));
+			VDP_WriteVRAMStrided((const uint8_t*)(data + (j * w) + i), rw << 1, rh, w << 1, vdp_plane_w << 1);
+			i += rw;
+		}
+		j += rh;
+	}
+}
+
+void VDP_SeekCRAM(size_t offset)
+{
+	vdp_cram_p = vdp_cram + offset;
+}
+
+void VDP_WriteCRAM(const uint16_t *data, size_t len)
+{
+	// Only dirty entries that change, as palettes are rewritten whole every frame
+	for (; len != 0; len--, vdp_cram_p++)
+	{
+		uint16_t cv = *data++;
+		if (*vdp_cram_p != cv)
+		{
+			*vdp_cram_p = cv;
+			vdp_cram_dirty[vdp_cram_p - vdp_cram] = 1;
+			vdp_cram_changed = true;
+		}
+	}
+}
+
+void VDP_FillCRAM(uint16_t data, size_t len)
+{
+	for (; len != 0; len--, vdp_cram_p++)
+	{
+		if (*vdp_cram_p != data)
+		{
+			*vdp_cram_p = data;
+			vdp_cram_dirty[vdp_cram_p - vdp_cram] = 1;
+			vdp_cram_changed = true;
+		}
+	}
+}
+
+void VDP_SetPlaneALocation(size_t loc)
+{
+	vdp_plane_a_location = loc;
+}
+
+void VDP_SetPlaneBLocation(size_t loc)
+{
+	vdp_plane_b_location = loc;
+}
+
+void VDP_SetSpriteLocation(size_t loc)
+{
+	vdp_sprite_location = loc;
+}
+
+void VDP_SetHScrollLocation(size_t loc)
+{
+	vdp_hscroll_location = loc;
+}
+
+void VDP_SetPlaneSize(size_t w, size_t h)
+{
+	vdp_plane_w = w;
+	vdp_plane_h = h;
+	vdp_plane_size = w * h * 2;
+}
+
+void VDP_SetBackgroundColour(uint8_t index)
+{
+	vdp_background_colour = index;
+}
+
+void VDP_SetVScroll(int16_t scroll_a, int16_t scroll_b)
+{
+	vdp_vscroll_a = scroll_a;
+	vdp_vscroll_b = scroll_b;
+}
+
+void VDP_SetHIntPosition(int16_t pos)
+{
+	vdp_hint_pos = pos;
+}
+
+// VDP rasterizer
+static void VDP_UpdateVRAM()
+{
+	// Deconstruct dirty VRAM blocks
+	for (size_t i = 0; i < (VRAM_SIZE / VDP_DIRTY_SIZE); i++)
+	{
+		if (vdp_vram_dirty[i])
+		{
+			Tile_Unpack(vdp_vram_8 + (i * VDP_DIRTY_SIZE * 2), vdp_vram + (i * VDP_DIRTY_SIZE), VDP_DIRTY_SIZE);
+			vdp_vram_dirty[i] = 0;
+		}
+	}
+}
+
+static void VDP_DrawTileRow(uint8_t *linep, uint16_t tile, size_t row)
+{
+	// Get tile pattern row
+	uint8_t attr = ((tile & TILE_PRIORITY_AND) ? VDP_PIXEL_PRIORITY : 0) | (((tile & TILE_PALETTE_AND) >> TILE_PALETTE_SHIFT) << 4);
+	if (tile & TILE_Y_FLIP_AND)
+		row ^= 7;
+	const uint8_t *patternp = vdp_vram_8 + ((size_t)(tile & TILE_PATTERN_AND) * TILE_SIZE_8) + (row << 3);
+	
+	// Write pixels, transparent pixels keep a colour index of 0
+	Tile_ExpandRow(linep, patternp, attr, (tile & TILE_X_FLIP_AND) != 0);
+}
+
+static void VDP_DrawPlaneLine(uint8_t *linep, size_t location, int16_t hscroll, int16_t vscroll, size_t y)
+{
+	// Get plane position
+	size_t px = (size_t)(-hscroll) & ((vdp_plane_w << 3) - 1);
+	size_t py = (y + (size_t)vscroll) & ((vdp_plane_h << 3) - 1);
+	
+	const uint16_t *rowp = (const uint16_t*)(vdp_vram + location + ((py >> 3) * vdp_plane_w << 1));
+	size_t cx = px >> 3;
+	
+	// Draw tiles, offset back by the fine scroll
+	linep -= px & 7;
+	for (size_t i = 0; i <= (SCREEN_WIDTH >> 3); i++, linep += 8)
+	{
+		VDP_DrawTileRow(linep, rowp[cx], py & 7);
+		cx = (cx + 1) & (vdp_plane_w - 1);
+	}
+}
+
+static void VDP_ParseSprites()
+{
+	// Walk sprite link list
+	vdp_sprites_num = 0;
+	for (uint8_t i = 0; vdp_sprites_num < SPRITES;)
+	{
+		// Get sprite values
+		const uint16_t *sprite = (const uint16_t*)(vdp_vram + vdp_sprite_location + ((size_t)i << 3));
+		uint16_t sprite_sl = sprite[1];
+		uint8_t sprite_link = (sprite_sl & SPRITE_SL_L_AND) >> SPRITE_SL_L_SHIFT;
+		
+		VDP_Sprite *parsed = &vdp_sprites[vdp_sprites_num++];
+		parsed->y = (int16_t)((sprite[0] & SPRITE_Y_AND) >> SPRITE_Y_SHIFT) - 0x80;
+		parsed->x = (int16_t)((sprite[3] & SPRITE_X_AND) >> SPRITE_X_SHIFT) - 0x80;
+		parsed->w = ((sprite_sl & SPRITE_SL_W_AND) >> SPRITE_SL_W_SHIFT) + 1;
+		parsed->h = ((sprite_sl & SPRITE_SL_H_AND) >> SPRITE_SL_H_SHIFT) + 1;
+		parsed->tile = sprite[2];
+		parsed->cut = false;
+		
+		// Go to next sprite
+		if (sprite_link != 0 && sprite_link < SPRITES)
+			i = sprite_link;
+		else
+			break;
+	}
+}
+
+static void VDP_DrawSpriteLine(uint8_t *linep, size_t y)
+{
+	// Draw sprites front to back, earlier sprites in the list take priority
+	uint8_t cell[8];
+	size_t sprites = 0, cells = 0;
+	bool cut = false;
+	
+	for (size_t i = 0; i < vdp_sprites_num; i++)
+	{
+		VDP_Sprite *sprite = &vdp_sprites[i];
+		
+		// Check if sprite is on this line
+		size_t sy = (size_t)((int)y - sprite->y);
+		if (sy >= ((size_t)sprite->h << 3))
+			continue;
+		
+		// Sprites count towards the line's limits even when they're off screen
+		size_t w = sprite->w;
+		if (sprites >= SPRITES_LINE)
+			w = 0;
+		else if (cells + w > CELLS_LINE)
+			w = (cells < CELLS_LINE) ? (CELLS_LINE - cells) : 0;
+		sprites++;
+		cells += sprite->w;
+		
+		if (w != sprite->w)
+		{
+			// Count overflow, only dropping cells if the limits are enforced
+			if (!sprite->cut)
+				vdp_stats.sprite_overflow++;
+			sprite->cut = true;
+			cut = true;
+			
+			if (vdp_sprite_limit == VDPSpriteLimit_None)
+				w = sprite->w;
+			else if (w == 0)
+				continue;
+		}
+		
+		if (sprite->x <= -((int)sprite->w << 3) || sprite->x >= SCREEN_WIDTH)
+			continue;
+		
+		// Get row to draw, tiles are arranged in columns
+		size_t row = sy >> 3;
+		if (sprite->tile & TILE_Y_FLIP_AND)
+			row = sprite->h - 1 - row;
+		
+		for (size_t x = 0; x < w; x++)
+		{
+			// Get cell to draw
+			size_t col = (sprite->tile & TILE_X_FLIP_AND) ? (sprite->w - 1 - x) : x;
+			uint16_t tile = sprite->tile + (uint16_t)(col * sprite->h + row);
+			tile = (sprite->tile & ~TILE_PATTERN_AND) | (tile & TILE_PATTERN_AND);
+			
+			int cx = sprite->x + (int)(x << 3);
+			if (cx <= -8 || cx >= SCREEN_WIDTH)
+				continue;
+			
+			// Draw cell without overwriting earlier sprites
+			VDP_DrawTileRow(cell, tile, sy & 7);
+			uint8_t *dstp = linep + cx;
+			for (size_t j = 0; j < 8; j++)
+				if (!(dstp[j] & VDP_PIXEL_INDEX))
+					dstp[j] = cell[j];
+		}
+	}
+	if (cut)
+		vdp_stats.line_overflow++;
+}
+
+static void VDP_Rasterize()
+{
+	// Convert changed CRAM entries
+	if (vdp_cram_changed)
+	{
+		for (size_t i = 0; i < COLOURS; i++)
+		{
+			if (!vdp_cram_dirty[i])
+				continue;
+			vdp_cram_dirty[i] = 0;
+			memcpy(vdp_cram_fmt[i], vdp_colour_lut[VDP_COLOUR_INDEX(vdp_cram[i])], 3);
+			vdp_stats.colours++;
+		}
+		vdp_cram_changed = false;
+	}
+	
+	// Update deconstructed VRAM and get sprites
+	PROFILE_BEGIN(VDP_VRAM);
+	VDP_UpdateVRAM();
+	PROFILE_END(VDP_VRAM);
+	VDP_ParseSprites();
+	
+	// Draw lines
+	ALIGNED4 uint8_t line_a[VDP_LINE_PAD + SCREEN_WIDTH + VDP_LINE_PAD];
+	ALIGNED4 uint8_t line_b[VDP_LINE_PAD + SCREEN_WIDTH + VDP_LINE_PAD];
+	ALIGNED4 uint8_t line_s[VDP_LINE_PAD + SCREEN_WIDTH + VDP_LINE_PAD];
+	
+	const int16_t *hscroll = (const int16_t*)(vdp_vram + vdp_hscroll_location);
+	
+	for (size_t y = 0; y < SCREEN_HEIGHT; y++, hscroll += 2)
+	{
+		// Draw layers
+		VDP_DrawPlaneLine(line_a + VDP_LINE_PAD, vdp_plane_a_location, hscroll[0], vdp_vscroll_a, y);
+		VDP_DrawPlaneLine(line_b + VDP_LINE_PAD, vdp_plane_b_location, hscroll[1], vdp_vscroll_b, y);
+		memset(line_s, 0, sizeof(line_s));
+		VDP_DrawSpriteLine(line_s + VDP_LINE_PAD, y);
+		
+		// Compose layers
+		const uint8_t *ap = line_a + VDP_LINE_PAD;
+		const uint8_t *bp = line_b + VDP_LINE_PAD;
+		const uint8_t *sp = line_s + VDP_LINE_PAD;
+		uint8_t *outp = vdp_framebuffer[y][0];
+		
+		for (size_t x = 0; x < SCREEN_WIDTH; x++, outp += 3)
+		{
+			// Priority order is high sprite, high A, high B, low sprite, low A, low B, background
+			uint8_t a = ap[x], b = bp[x], s = sp[x];
+			uint8_t v;
+			if (!(a & VDP_PIXEL_INDEX))
+				a = 0;
+			if (!(b & VDP_PIXEL_INDEX))
+				b = 0;
+			if (!(s & VDP_PIXEL_INDEX))
+				s = 0;
+			
+			if (s & VDP_PIXEL_PRIORITY)
+				v = s;
+			else if (a & VDP_PIXEL_PRIORITY)
+				v = a;
+			else if (b & VDP_PIXEL_PRIORITY)
+				v = b;
+			else if (s)
+				v = s;
+			else if (a)
+				v = a;
+			else if (b)
+				v = b;
+			else
+				v = vdp_background_colour;
+			
+			const uint8_t *colp = vdp_cram_fmt[v & VDP_PIXEL_COLOUR];
+			outp[0] = colp[0];
+			outp[1] = colp[1];
+			outp[2] = colp[2];
+		}
+	}
+}
+
+static void VDP_Capture()
+{
+	// Write framebuffer to a PPM file
+	char path[0x200];
+	snprintf(path, sizeof(path), "%s%06lu.ppm", host_capture, host_frame);
+	
+	FILE *fp = fopen(path, "wb");
+	if (fp == NULL)
+	{
+		fprintf(stderr, "Couldn't open '%s'\n", path);
+		return;
+	}
+	fprintf(fp, "P6\n%d %d\n255\n", SCREEN_WIDTH, SCREEN_HEIGHT);
+	fwrite(vdp_framebuffer, 1, sizeof(vdp_framebuffer), fp);
+	fclose(fp);
+}
+
+// Host interface
+const uint8_t *VDP_GetFramebuffer()
+{
+	return &vdp_framebuffer[0][0][0];
+}
+
+const uint8_t *VDP_GetVRAM()
+{
+	return vdp_vram;
+}
+
+// VDP rendering
+const VDP_Stats *VDP_GetStats()
+{
+	return &vdp_stats;
+}
+
+void VDP_SetRenderInterval(unsigned int interval)
+{
+	vdp_render_interval = interval;
+	vdp_render_count = 0;
+}
+
+void VDP_SetSpriteLimit(VDPSpriteLimit limit)
+{
+	vdp_sprite_limit = limit;
+}
+
+void VDP_Render()
+{
+	// Reset statistics
+	// There's no video memory to transfer to, so only rasterizer counters are kept
+	memset(&vdp_stats, 0, sizeof(vdp_stats));
+	
+	// Rasterize frame if it's due
+	// Writes made in skipped frames stay dirty until the next frame that's drawn
+	if (vdp_render_interval != 0 && ++vdp_render_count >= vdp_render_interval)
+	{
+		vdp_render_count = 0;
+		
+		PROFILE_BEGIN(VDP_Render);
+		PROFILE_BEGIN(VDP_Draw);
+		VDP_Rasterize();
+		PROFILE_END(VDP_Draw);
+		
+		if (vdp_sprite_report && vdp_stats.line_overflow != 0)
+			fprintf(stderr, "Frame %lu: %lu sprites over the limits on %lu lines\n", host_frame, (unsigned long)vdp_stats.sprite_overflow, (unsigned long)vdp_stats.line_overflow);
+		
+		PROFILE_BEGIN(VDP_Output);
+		if (host_capture != NULL)
+			VDP_Capture();
+		PROFILE_END(VDP_Output);
+		PROFILE_END(VDP_Render);
+	}
+	
+	// Check frame limit
+	if (++host_frame == host_frame_limit)
+	{
+		// The timer starts right after VDP_Init
+		uint32_t ticks = Timer_GetTicks();
+		fprintf(stderr, "%lu frames in %lu.%02lus", host_frame, (unsigned long)(ticks / 100), (unsigned long)(ticks % 100));
+		if (ticks != 0)
+			fprintf(stderr, " (%lu fps)", (unsigned long)(host_frame * 100 / ticks));
+		fprintf(stderr, "\n");
+		exit(0);
+	}
+	
+	// Send vertical interrupt
+	// There's no display to wait on, so frames run as fast as the host allows
+	vdp_vint();
+}
@@ -2,13 +2,20 @@
 
 #include "VDP.h"
 #include "Joypad.h"
+#include "Timer.h"
+#include "Profile.h"
+#include "Replay.h"
 
 // MegaDrive interface
 void MegaDrive_Start(const MD_Header *header)
 {
 	// Initialize the VDP
+	// The timer's interrupt can only be installed once VDP_Init has reset the GPU and the interrupt handlers
 	VDP_Init(header);
+	Timer_Init();
+	Profile_Init();
 	Joypad_Init();
+	Replay_Init();
 
 	// Run entry point
 	header->entry_point();
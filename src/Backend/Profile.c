@@ -0,0 +1,214 @@
+#include "Profile.h"
+
+#include "Timer.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+#ifdef SCP_HOST
+	#include <stdio.h>
+	#include <stdlib.h>
+#endif
+
+// Profile constants
+static const char *profile_phase_name[ProfilePhase_Num] = {
+	"WaitForVBla",
+	"MoveSonicInDemo",
+	"ExecuteObjects",
+	"DeformLayers",
+	"BuildSprites",
+	"ObjPosLoad",
+	"PaletteCycle",
+	"RunPLC",
+	"SynchroAnimate",
+	
+	"VBlank",
+	"ReadJoypads",
+	"CopyBuffers",
+	"LoadTilesAsYouMove",
+	"AnimateLevelGfx",
+	"HUD_Update",
+	"ProcessDPLC",
+	
+	"VDP_Render",
+	"VDP_Draw",
+	"VDP_VRAM",
+	"VDP_Output",
+};
+
+#ifdef SCP_PROFILE
+
+// Profile state
+// The frame at profile_head is the one being recorded, the others are complete
+static Profile_Frame profile_frame[PROFILE_FRAMES];
+static size_t profile_head, profile_frames;
+
+static uint32_t profile_begin[ProfilePhase_Num];
+
+#ifdef SCP_HOST
+static const char *profile_path;
+
+// Host dump
+static void Profile_Dump()
+{
+	FILE *fp = fopen(profile_path, "w");
+	if (fp == NULL)
+	{
+		fprintf(stderr, "Failed to open %s\n", profile_path);
+		return;
+	}
+	
+	// Check format
+	size_t path_len = strlen(profile_path);
+	bool json = path_len >= 5 && strcmp(profile_path + path_len - 5, ".json") == 0;
+	
+	if (json)
+	{
+		// Name a track for the frames and one for each phase
+		// Phases are only kept as totals per frame, so each gets its own track where its total
+		// time starts from when it was first entered, rather than nesting under the others
+		fprintf(fp, "{\"traceEvents\":[\n");
+		fprintf(fp, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"Frame\"}}");
+		for (size_t j = 0; j < ProfilePhase_Num; j++)
+		{
+			fprintf(fp, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%lu,\"args\":{\"name\":\"%s\"}}",
+				(unsigned long)(j + 1), profile_phase_name[j]);
+			fprintf(fp, ",\n{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":1,\"tid\":%lu,\"args\":{\"sort_index\":%lu}}",
+				(unsigned long)(j + 1), (unsigned long)(j + 1));
+		}
+		
+		// Write Chrome trace events, oldest frame first
+		for (size_t i = profile_frames; i-- != 0;)
+		{
+			const Profile_Frame *frame = Profile_GetFrame(i);
+			fprintf(fp, ",\n{\"name\":\"Frame\",\"ph\":\"X\",\"pid\":1,\"tid\":0,\"ts\":%lu,\"dur\":%lu,\"args\":{\"frame\":%lu}}",
+				(unsigned long)frame->start, (unsigned long)frame->time, (unsigned long)frame->index);
+			
+			for (size_t j = 0; j < ProfilePhase_Num; j++)
+			{
+				if (frame->phase_calls[j] == 0)
+					continue;
+				fprintf(fp, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%lu,\"ts\":%lu,\"dur\":%lu,\"args\":{\"calls\":%u}}",
+					profile_phase_name[j], (unsigned long)(j + 1), (unsigned long)(frame->start + frame->phase_start[j]), (unsigned long)frame->phase_time[j], (unsigned)frame->phase_calls[j]);
+			}
+		}
+		fprintf(fp, "\n");
+		fprintf(fp, "],\"displayTimeUnit\":\"ms\"}\n");
+	}
+	else
+	{
+		// Write a row of phase times per frame, oldest frame first
+		fprintf(fp, "frame,start,time");
+		for (size_t j = 0; j < ProfilePhase_Num; j++)
+			fprintf(fp, ",%s", profile_phase_name[j]);
+		fprintf(fp, "\n");
+		
+		for (size_t i = profile_frames; i-- != 0;)
+		{
+			const Profile_Frame *frame = Profile_GetFrame(i);
+			fprintf(fp, "%lu,%lu,%lu", (unsigned long)frame->index, (unsigned long)frame->start, (unsigned long)frame->time);
+			for (size_t j = 0; j < ProfilePhase_Num; j++)
+				fprintf(fp, ",%lu", (unsigned long)frame->phase_time[j]);
+			fprintf(fp, "\n");
+		}
+	}
+	
+	fclose(fp);
+}
+#endif
+
+// Profile interface
+void Profile_Init()
+{
+	// Start first frame
+	memset(profile_frame, 0, sizeof(profile_frame));
+	profile_head = 0;
+	profile_frames = 0;
+	profile_frame[0].start = Timer_GetMicros();
+
+#ifdef SCP_HOST
+	// Get dump path
+	// SCP_PROFILE=path writes the kept frames to path on exit
+	profile_path = getenv("SCP_PROFILE");
+	if (profile_path != NULL && *profile_path != '\0')
+		atexit(Profile_Dump);
+#endif
+}
+
+void Profile_NextFrame()
+{
+	// End current frame
+	uint32_t now = Timer_GetMicros();
+	Profile_Frame *frame = &profile_frame[profile_head];
+	frame->time = now - frame->start;
+	
+	uint32_t index = frame->index + 1;
+	if (profile_frames < PROFILE_FRAMES - 1)
+		profile_frames++;
+	
+	// Start next frame, overwriting the oldest
+	if (++profile_head == PROFILE_FRAMES)
+		profile_head = 0;
+	frame = &profile_frame[profile_head];
+	memset(frame, 0, sizeof(Profile_Frame));
+	frame->index = index;
+	frame->start = now;
+}
+
+void Profile_Begin(ProfilePhase phase)
+{
+	uint32_t now = Timer_GetMicros();
+	Profile_Frame *frame = &profile_frame[profile_head];
+	if (frame->phase_calls[phase]++ == 0)
+		frame->phase_start[phase] = now - frame->start;
+	profile_begin[phase] = now;
+}
+
+void Profile_End(ProfilePhase phase)
+{
+	// Phases that span a frame boundary are counted towards the frame they end in
+	profile_frame[profile_head].phase_time[phase] += Timer_GetMicros() - profile_begin[phase];
+}
+
+const Profile_Frame *Profile_GetFrame(size_t i)
+{
+	if (i >= profile_frames)
+		return NULL;
+	return &profile_frame[(profile_head + PROFILE_FRAMES - 1 - i) % PROFILE_FRAMES];
+}
+
+#else
+
+// Profile interface
+void Profile_Init()
+{
+
+}
+
+void Profile_NextFrame()
+{
+
+}
+
+void Profile_Begin(ProfilePhase phase)
+{
+	(void)phase;
+}
+
+void Profile_End(ProfilePhase phase)
+{
+	(void)phase;
+}
+
+const Profile_Frame *Profile_GetFrame(size_t i)
+{
+	(void)i;
+	return NULL;
+}
+
+#endif
+
+const char *Profile_GetPhaseName(ProfilePhase phase)
+{
+	return profile_phase_name[phase];
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Profile constants
+// The last PROFILE_FRAMES frames are kept, a frame being the time between two calls to Profile_Frame
+#ifndef SCP_PROFILE_FRAMES
+	#define SCP_PROFILE_FRAMES 256
+#endif
+
+#define PROFILE_FRAMES SCP_PROFILE_FRAMES
+
+// Profile phases
+typedef enum
+{
+	// Game loop
+	ProfilePhase_WaitForVBla,
+	ProfilePhase_MoveSonicInDemo,
+	ProfilePhase_ExecuteObjects,
+	ProfilePhase_DeformLayers,
+	ProfilePhase_BuildSprites,
+	ProfilePhase_ObjPosLoad,
+	ProfilePhase_PaletteCycle,
+	ProfilePhase_RunPLC,
+	ProfilePhase_SynchroAnimate,
+	
+	// Vertical interrupt
+	ProfilePhase_VBlank,
+	ProfilePhase_ReadJoypads,
+	ProfilePhase_CopyBuffers,
+	ProfilePhase_LoadTilesAsYouMove,
+	ProfilePhase_AnimateLevelGfx,
+	ProfilePhase_HUD_Update,
+	ProfilePhase_ProcessDPLC,
+	
+	// VDP render
+	ProfilePhase_VDP_Render,
+	ProfilePhase_VDP_Draw,   // Building primitives (PSX) or rasterizing, which includes VDP_VRAM (host)
+	ProfilePhase_VDP_VRAM,   // Updating deconstructed VRAM
+	ProfilePhase_VDP_Output, // Waiting for and presenting the frame (PSX) or capturing it (host)
+	
+	ProfilePhase_Num,
+} ProfilePhase;
+
+// Profile frame
+typedef struct
+{
+	uint32_t index;                         // Frames counted before this one
+	uint32_t start;                         // Microseconds the frame started at
+	uint32_t time;                          // Microseconds the frame took
+	uint32_t phase_start[ProfilePhase_Num]; // Microseconds into the frame each phase first started
+	uint32_t phase_time[ProfilePhase_Num];  // Microseconds spent in each phase
+	uint16_t phase_calls[ProfilePhase_Num]; // Times each phase was entered
+} Profile_Frame;
+
+// Profile interface
+// When SCP_PROFILE isn't defined, no frames are kept and PROFILE_FRAME, PROFILE_BEGIN and PROFILE_END
+// compile to nothing.
+// On the host, SCP_PROFILE=path dumps the kept frames on exit, as Chrome trace JSON (with a track
+// per phase) if the path ends in .json or CSV otherwise
+#ifdef SCP_PROFILE
+	#define PROFILE_FRAME()      Profile_NextFrame()
+	#define PROFILE_BEGIN(phase) Profile_Begin(ProfilePhase_##phase)
+	#define PROFILE_END(phase)   Profile_End(ProfilePhase_##phase)
+#else
+	#define PROFILE_FRAME()
+	#define PROFILE_BEGIN(phase)
+	#define PROFILE_END(phase)
+#endif
+
+void Profile_Init();
+void Profile_NextFrame();
+void Profile_Begin(ProfilePhase phase);
+void Profile_End(ProfilePhase phase);
+
+// Frames are indexed from the most recently completed (0) backwards, NULL past the last kept frame
+const Profile_Frame *Profile_GetFrame(size_t i);
+const char *Profile_GetPhaseName(ProfilePhase phase);
@@ -0,0 +1,319 @@
+#include "Replay.h"
+
+#include <string.h>
+
+#ifdef SCP_HOST
+	#include <stdio.h>
+	#include <stdlib.h>
+#endif
+
+// Replay constants
+#define REPLAY_HEADER_SIZE 5
+#define REPLAY_INPUT_SIZE  5
+#define REPLAY_LEVEL_SIZE  7
+
+#define REPLAY_RUN_MAX 0xFFFF
+
+static const uint8_t replay_header[REPLAY_HEADER_SIZE] = { 'S', 'C', 'P', 'R', REPLAY_VERSION };
+
+// Replay state
+static ReplayState replay_state;
+
+// Recorded stream, one byte is always kept free for the end record
+static uint8_t replay_data[REPLAY_SIZE];
+static size_t replay_size;
+
+// Played stream
+static const uint8_t *replay_stream;
+static size_t replay_stream_size, replay_stream_pos;
+
+// Current run of joypad reads
+static uint16_t replay_run;
+static uint8_t replay_run_pad1, replay_run_pad2;
+
+static uint32_t replay_reads;
+
+#ifdef SCP_HOST
+static const char *replay_path;
+
+// Host stream files
+static void Replay_Save()
+{
+	size_t size;
+	const uint8_t *data = Replay_GetData(&size);
+	
+	FILE *fp = fopen(replay_path, "wb");
+	if (fp == NULL || fwrite(data, 1, size, fp) != size)
+		fprintf(stderr, "Failed to write replay %s\n", replay_path);
+	if (fp != NULL)
+		fclose(fp);
+}
+
+static bool Replay_Load(const char *path)
+{
+	FILE *fp = fopen(path, "rb");
+	if (fp == NULL)
+	{
+		fprintf(stderr, "Failed to open replay %s\n", path);
+		return false;
+	}
+	
+	// Read stream into the record buffer, failing if it doesn't fit
+	size_t size = fread(replay_data, 1, sizeof(replay_data), fp);
+	bool fits = fgetc(fp) == EOF;
+	fclose(fp);
+	
+	if (!fits || !Replay_Play(replay_data, size))
+	{
+		fprintf(stderr, "Invalid replay %s\n", path);
+		return false;
+	}
+	return true;
+}
+#endif
+
+// Internal functions
+static void Replay_Finish(bool desync)
+{
+	// Stop playing, passing the joypads through from now on
+	replay_state = ReplayState_Done;
+
+#ifdef SCP_HOST
+	// Exit, so a replayed session runs exactly as long as the recorded one
+	if (desync)
+	{
+		fprintf(stderr, "Replay desynced after %lu joypad reads\n", (unsigned long)replay_reads);
+		exit(1);
+	}
+	fprintf(stderr, "Replay ended after %lu joypad reads\n", (unsigned long)replay_reads);
+	exit(0);
+#else
+	(void)desync;
+#endif
+}
+
+static bool Replay_Write(const uint8_t *record, size_t size)
+{
+	// Stop recording if the buffer is full
+	if (replay_state != ReplayState_Record)
+		return false;
+	if (REPLAY_SIZE - 1 - replay_size < size)
+	{
+	#ifdef SCP_HOST
+		fprintf(stderr, "Replay buffer full after %lu joypad reads\n", (unsigned long)replay_reads);
+	#endif
+		replay_state = ReplayState_Done;
+		return false;
+	}
+	
+	memcpy(replay_data + replay_size, record, size);
+	replay_size += size;
+	return true;
+}
+
+static void Replay_FlushRun()
+{
+	// Write current run of joypad reads
+	if (replay_run == 0)
+		return;
+	
+	uint8_t record[REPLAY_INPUT_SIZE] = {
+		REPLAY_RECORD_INPUT,
+		replay_run >> 8,
+		replay_run,
+		replay_run_pad1,
+		replay_run_pad2,
+	};
+	Replay_Write(record, sizeof(record));
+	replay_run = 0;
+}
+
+static const uint8_t *Replay_Read(uint8_t type, size_t size)
+{
+	// Read a record of the given type, failing on anything else
+	if (replay_stream_size - replay_stream_pos < size || replay_stream[replay_stream_pos] != type)
+		return NULL;
+	
+	const uint8_t *record = replay_stream + replay_stream_pos;
+	replay_stream_pos += size;
+	return record;
+}
+
+// Replay interface
+void Replay_Init()
+{
+	replay_state = ReplayState_Off;
+	replay_size = 0;
+	replay_stream = NULL;
+	replay_run = 0;
+	replay_reads = 0;
+
+#ifdef SCP_HOST
+	// Start recording or playing
+	const char *record = getenv("SCP_RECORD");
+	const char *play = getenv("SCP_REPLAY");
+	
+	if (play != NULL && *play != '\0')
+	{
+		if (!Replay_Load(play))
+			exit(1);
+	}
+	else if (record != NULL && *record != '\0')
+	{
+		replay_path = record;
+		Replay_Record();
+		atexit(Replay_Save);
+	}
+#endif
+}
+
+bool Replay_Record()
+{
+	// Start new stream
+	memcpy(replay_data, replay_header, REPLAY_HEADER_SIZE);
+	replay_size = REPLAY_HEADER_SIZE;
+	replay_run = 0;
+	replay_reads = 0;
+	
+	replay_state = ReplayState_Record;
+	return true;
+}
+
+bool Replay_Play(const uint8_t *data, size_t size)
+{
+	// Check header
+	if (size < REPLAY_HEADER_SIZE || memcmp(data, replay_header, REPLAY_HEADER_SIZE) != 0)
+		return false;
+	
+	// Start playing stream
+	replay_stream = data;
+	replay_stream_size = size;
+	replay_stream_pos = REPLAY_HEADER_SIZE;
+	replay_run = 0;
+	replay_reads = 0;
+	
+	replay_state = ReplayState_Play;
+	return true;
+}
+
+void Replay_Stop()
+{
+	if (replay_state == ReplayState_Record)
+		Replay_FlushRun();
+	replay_state = ReplayState_Off;
+}
+
+ReplayState Replay_GetState()
+{
+	return replay_state;
+}
+
+bool Replay_Active()
+{
+	return replay_state == ReplayState_Record || replay_state == ReplayState_Play;
+}
+
+const uint8_t *Replay_GetData(size_t *size)
+{
+	// Terminate the recorded stream in the byte kept free for it
+	if (replay_state == ReplayState_Record)
+		Replay_FlushRun();
+	if (replay_size == 0)
+	{
+		*size = 0;
+		return NULL;
+	}
+	
+	replay_data[replay_size] = REPLAY_RECORD_END;
+	*size = replay_size + 1;
+	return replay_data;
+}
+
+void Replay_Joypad(uint8_t *pad1, uint8_t *pad2)
+{
+	switch (replay_state)
+	{
+		case ReplayState_Record:
+			// Extend the current run, or start a new one
+			if (replay_run != 0 && replay_run != REPLAY_RUN_MAX && *pad1 == replay_run_pad1 && *pad2 == replay_run_pad2)
+			{
+				replay_run++;
+			}
+			else
+			{
+				Replay_FlushRun();
+				replay_run = 1;
+				replay_run_pad1 = *pad1;
+				replay_run_pad2 = *pad2;
+			}
+			replay_reads++;
+			break;
+		case ReplayState_Play:
+			// Start the next run once the current one's used up
+			if (replay_run == 0)
+			{
+				// Anything other than the end record where a run should be means the game
+				// read the joypads where it started a level when recording
+				const uint8_t *record = Replay_Read(REPLAY_RECORD_INPUT, REPLAY_INPUT_SIZE);
+				if (record == NULL)
+				{
+					Replay_Finish(replay_stream_pos == replay_stream_size || replay_stream[replay_stream_pos] != REPLAY_RECORD_END);
+					break;
+				}
+				replay_run = (record[1] << 8) | record[2];
+				if (replay_run == 0)
+				{
+					Replay_Finish(true);
+					break;
+				}
+				replay_run_pad1 = record[3];
+				replay_run_pad2 = record[4];
+			}
+			
+			// Feed joypads from the run
+			*pad1 = replay_run_pad1;
+			*pad2 = replay_run_pad2;
+			replay_run--;
+			replay_reads++;
+			break;
+		default:
+			break;
+	}
+}
+
+void Replay_Level(uint16_t level, uint32_t *seed)
+{
+	switch (replay_state)
+	{
+		case ReplayState_Record:
+		{
+			Replay_FlushRun();
+			
+			uint8_t record[REPLAY_LEVEL_SIZE] = {
+				REPLAY_RECORD_LEVEL,
+				level >> 8,
+				level,
+				*seed >> 24,
+				*seed >> 16,
+				*seed >> 8,
+				*seed,
+			};
+			Replay_Write(record, sizeof(record));
+			break;
+		}
+		case ReplayState_Play:
+		{
+			// The level should start exactly where it did when recording
+			const uint8_t *record = (replay_run == 0) ? Replay_Read(REPLAY_RECORD_LEVEL, REPLAY_LEVEL_SIZE) : NULL;
+			if (record == NULL || ((record[1] << 8) | record[2]) != level)
+			{
+				Replay_Finish(true);
+				break;
+			}
+			*seed = ((uint32_t)record[3] << 24) | ((uint32_t)record[4] << 16) | ((uint32_t)record[5] << 8) | record[6];
+			break;
+		}
+		default:
+			break;
+	}
+}
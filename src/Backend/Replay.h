@@ -0,0 +1,48 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+// Replay constants
+#ifndef SCP_REPLAY_SIZE
+	#define SCP_REPLAY_SIZE 0x10000
+#endif
+
+#define REPLAY_SIZE SCP_REPLAY_SIZE
+
+// Replay stream
+// After a 5 byte header ("SCPR" and the format version), the stream is a list of records:
+//   REPLAY_RECORD_INPUT  (count high, count low, pad 1, pad 2) - Joypads read the same count times in a row
+//   REPLAY_RECORD_LEVEL  (level high, level low, seed, most significant byte first) - A level started
+//   REPLAY_RECORD_END    - End of stream
+#define REPLAY_VERSION 1
+
+#define REPLAY_RECORD_END   0x00
+#define REPLAY_RECORD_INPUT 0x01
+#define REPLAY_RECORD_LEVEL 0x02
+
+typedef enum
+{
+	ReplayState_Off,    // Joypads are read as normal
+	ReplayState_Record, // Joypads are read as normal and recorded
+	ReplayState_Play,   // Joypads are read from the stream
+	ReplayState_Done,   // The stream ended, or stopped matching what the game did
+} ReplayState;
+
+// Replay interface
+// On the host, SCP_RECORD=path records from boot and writes the stream to path on exit, and
+// SCP_REPLAY=path plays the stream in path from boot, exiting once it ends
+void Replay_Init();
+
+bool Replay_Record();
+bool Replay_Play(const uint8_t *data, size_t size);
+void Replay_Stop();
+
+ReplayState Replay_GetState();
+bool Replay_Active();
+const uint8_t *Replay_GetData(size_t *size);
+
+// Called by the game for every joypad read and level start, replacing the values while playing
+void Replay_Joypad(uint8_t *pad1, uint8_t *pad2);
+void Replay_Level(uint16_t level, uint32_t *seed);
@@ -0,0 +1,240 @@
+#include "Rewind.h"
+
+#include "State.h"
+#include "Timer.h"
+
+#include <string.h>
+
+// Rewind state
+static Rewind_Stats rewind_stats;
+
+#if REWIND_SIZE != 0
+
+// Rewind constants
+#define REWIND_RUN_MAX 0xFFFF
+
+// Rewind arena
+// Split into the newest state, a scratch state, then the ring of deltas
+static uint32_t rewind_arena[REWIND_SIZE / 4];
+
+static uint32_t *rewind_state, *rewind_scratch;
+static uint8_t *rewind_ring;
+static size_t rewind_words;
+static bool rewind_base;
+
+// Deltas in the ring, oldest first
+static struct
+{
+	uint32_t pos, size;
+} rewind_delta[REWIND_FRAMES];
+static size_t rewind_tail, rewind_deltas;
+
+#define REWIND_DELTA(i) (rewind_delta[(rewind_tail + (i)) % REWIND_FRAMES])
+
+// Delta encoding
+// Each run is a word holding a count of zero words (high) and a count of literal words (low),
+// followed by the literal words. Single zero words are kept in literal runs
+static size_t Rewind_Encode(const uint32_t *delta, uint32_t *out)
+{
+	size_t size = 0;
+	for (size_t i = 0; i < rewind_words;)
+	{
+		size_t zero = 0;
+		while (i < rewind_words && zero < REWIND_RUN_MAX && delta[i] == 0)
+		{
+			i++;
+			zero++;
+		}
+		
+		size_t literal = 0;
+		while (i + literal < rewind_words && literal < REWIND_RUN_MAX)
+		{
+			if (delta[i + literal] == 0 && (i + literal + 1 == rewind_words || delta[i + literal + 1] == 0))
+				break;
+			literal++;
+		}
+		
+		if (out != NULL)
+		{
+			*out++ = (zero << 16) | literal;
+			memcpy(out, delta + i, literal * 4);
+			out += literal;
+		}
+		size += (1 + literal) * 4;
+		i += literal;
+	}
+	return size;
+}
+
+static void Rewind_Apply(uint32_t *state, const uint32_t *in)
+{
+	// XOR delta into state
+	for (size_t i = 0; i < rewind_words;)
+	{
+		uint32_t run = *in++;
+		i += run >> 16;
+		for (size_t j = run & 0xFFFF; j != 0; j--)
+			state[i++] ^= *in++;
+	}
+}
+
+// Ring
+static void Rewind_Drop()
+{
+	// Drop the oldest delta
+	rewind_stats.used -= rewind_delta[rewind_tail].size;
+	rewind_tail = (rewind_tail + 1) % REWIND_FRAMES;
+	rewind_deltas--;
+}
+
+static uint8_t *Rewind_Alloc(size_t size)
+{
+	if (size > rewind_stats.ring)
+		return NULL;
+	if (rewind_deltas == REWIND_FRAMES)
+		Rewind_Drop();
+	
+	// Place after the newest delta, wrapping to the start of the ring if it doesn't fit before the end
+	size_t pos = 0;
+	if (rewind_deltas != 0)
+	{
+		pos = REWIND_DELTA(rewind_deltas - 1).pos + REWIND_DELTA(rewind_deltas - 1).size;
+		if (pos + size > rewind_stats.ring)
+		{
+			// Drop the deltas between here and the end first
+			while (rewind_deltas != 0 && rewind_delta[rewind_tail].pos >= pos)
+				Rewind_Drop();
+			pos = 0;
+		}
+	}
+	
+	// Drop the deltas in the way
+	while (rewind_deltas != 0 && rewind_delta[rewind_tail].pos < pos + size && pos < rewind_delta[rewind_tail].pos + rewind_delta[rewind_tail].size)
+		Rewind_Drop();
+	if (rewind_deltas == 0)
+		pos = 0;
+	
+	REWIND_DELTA(rewind_deltas).pos = pos;
+	REWIND_DELTA(rewind_deltas).size = size;
+	rewind_deltas++;
+	rewind_stats.used += size;
+	return rewind_ring + pos;
+}
+
+// Rewind interface
+bool Rewind_Push()
+{
+	uint32_t start = Timer_GetMicros();
+	
+	// Split the arena once the state's size is known
+	if (rewind_ring == NULL)
+	{
+		rewind_words = State_GetSize() / 4;
+		if (rewind_words * 8 >= REWIND_SIZE)
+			return false;
+		rewind_state = rewind_arena;
+		rewind_scratch = rewind_arena + rewind_words;
+		rewind_ring = (uint8_t*)(rewind_arena + rewind_words * 2);
+		rewind_stats.ring = REWIND_SIZE - rewind_words * 8;
+	}
+	
+	// Keep the first state whole
+	if (!rewind_base)
+	{
+		rewind_base = State_Save(rewind_state, rewind_words * 4) != 0;
+		return rewind_base;
+	}
+	
+	// Take the difference from the previous state, keeping the new one
+	State_Save(rewind_scratch, rewind_words * 4);
+	for (size_t i = 0; i < rewind_words; i++)
+	{
+		uint32_t next = rewind_scratch[i];
+		rewind_scratch[i] ^= rewind_state[i];
+		rewind_state[i] = next;
+	}
+	
+	// Push the difference
+	size_t size = Rewind_Encode(rewind_scratch, NULL);
+	uint8_t *delta = Rewind_Alloc(size);
+	if (delta == NULL)
+	{
+		// The history's lost, but the new state can still be stepped back to later
+		rewind_tail = 0;
+		rewind_deltas = 0;
+		rewind_stats.used = 0;
+		rewind_stats.frames = 0;
+		return false;
+	}
+	Rewind_Encode(rewind_scratch, (uint32_t*)delta);
+	rewind_stats.frames = rewind_deltas;
+	
+	// Update statistics
+	uint32_t time = Timer_GetMicros() - start;
+	rewind_stats.delta = size;
+	if (size > rewind_stats.delta_max)
+		rewind_stats.delta_max = size;
+	rewind_stats.time = time;
+	if (time > rewind_stats.time_max)
+		rewind_stats.time_max = time;
+	return true;
+}
+
+bool Rewind_Pop()
+{
+	if (rewind_deltas == 0)
+		return false;
+	
+	// Undo the newest difference, and load the state before it
+	rewind_deltas--;
+	Rewind_Apply(rewind_state, (const uint32_t*)(rewind_ring + REWIND_DELTA(rewind_deltas).pos));
+	rewind_stats.used -= REWIND_DELTA(rewind_deltas).size;
+	rewind_stats.frames = rewind_deltas;
+	return State_Load(rewind_state, rewind_words * 4);
+}
+
+void Rewind_Clear()
+{
+	rewind_base = false;
+	rewind_tail = 0;
+	rewind_deltas = 0;
+	rewind_stats.used = 0;
+	rewind_stats.frames = 0;
+}
+
+size_t Rewind_GetCapacity()
+{
+	if (rewind_deltas == 0)
+		return 0;
+	return rewind_stats.ring / (rewind_stats.used / rewind_deltas);
+}
+
+#else
+
+// Rewind interface
+bool Rewind_Push()
+{
+	return false;
+}
+
+bool Rewind_Pop()
+{
+	return false;
+}
+
+void Rewind_Clear()
+{
+
+}
+
+size_t Rewind_GetCapacity()
+{
+	return 0;
+}
+
+#endif
+
+const Rewind_Stats *Rewind_GetStats()
+{
+	return &rewind_stats;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+// Rewind constants
+// The whole budget, including two full copies of the state used to take deltas; 0 disables rewinding
+#ifndef SCP_REWIND_SIZE
+	#define SCP_REWIND_SIZE 0
+#endif
+#ifndef SCP_REWIND_FRAMES
+	#define SCP_REWIND_FRAMES 0x1000
+#endif
+
+#define REWIND_SIZE   SCP_REWIND_SIZE
+#define REWIND_FRAMES SCP_REWIND_FRAMES
+
+// Rewind history
+// The newest state is kept whole, and each older one as the difference from the state after it,
+// XORed and run length encoded over words. Stepping back only has to undo the newest difference,
+// and the oldest differences are dropped when the ring runs out of space or REWIND_FRAMES is reached
+typedef struct
+{
+	size_t frames;   // States that can be stepped back to
+	size_t used;     // Bytes of the ring used by them
+	size_t ring;     // Bytes of the ring
+	size_t delta;    // Bytes the last pushed state took
+	size_t delta_max;
+	uint32_t time;   // Microseconds the last push took
+	uint32_t time_max;
+} Rewind_Stats;
+
+// Rewind interface
+// States must be pushed and popped from the same point in the game loop, as with State_Load
+bool Rewind_Push();
+bool Rewind_Pop();
+void Rewind_Clear();
+
+const Rewind_Stats *Rewind_GetStats();
+size_t Rewind_GetCapacity(); // States that fit in the ring at the average size so far
@@ -0,0 +1,105 @@
+#include "State.h"
+
+#include <string.h>
+
+// State constants
+static const uint8_t state_magic[4] = { 'S', 'C', 'P', 'S' };
+
+#define STATE_PAD(x) (((x) + 3) & ~(size_t)3)
+
+// State registry
+static struct
+{
+	const State_Region *region;
+	size_t regions;
+	void (*load)();
+} state_module[STATE_MODULES];
+static size_t state_modules;
+
+static uint32_t state_layout = 0x811C9DC5; // FNV-1a
+static size_t state_size = sizeof(State_Header);
+
+// State interface
+bool State_Register(const State_Region *region, size_t regions, void (*load)())
+{
+	if (state_modules == STATE_MODULES)
+		return false;
+	
+	// Add module
+	state_module[state_modules].region = region;
+	state_module[state_modules].regions = regions;
+	state_module[state_modules].load = load;
+	state_modules++;
+	
+	// Extend layout
+	for (size_t i = 0; i < regions; i++)
+	{
+		for (size_t j = 0; j < sizeof(uint32_t); j++)
+			state_layout = (state_layout ^ (uint8_t)(region[i].size >> (j << 3))) * 0x01000193;
+		state_size += STATE_PAD(region[i].size);
+	}
+	return true;
+}
+
+size_t State_GetSize()
+{
+	return state_size;
+}
+
+size_t State_Save(void *blob, size_t size)
+{
+	if (size < state_size)
+		return 0;
+	
+	// Write header
+	State_Header *header = (State_Header*)blob;
+	memcpy(header->magic, state_magic, sizeof(state_magic));
+	header->version = STATE_VERSION;
+	header->layout = state_layout;
+	header->size = state_size;
+	
+	// Write regions
+	uint8_t *p = (uint8_t*)blob + sizeof(State_Header);
+	for (size_t i = 0; i < state_modules; i++)
+	{
+		for (size_t j = 0; j < state_module[i].regions; j++)
+		{
+			const State_Region *region = &state_module[i].region[j];
+			memcpy(p, region->data, region->size);
+			memset(p + region->size, 0, STATE_PAD(region->size) - region->size);
+			p += STATE_PAD(region->size);
+		}
+	}
+	return state_size;
+}
+
+bool State_Load(const void *blob, size_t size)
+{
+	// Check header
+	const State_Header *header = (const State_Header*)blob;
+	if (size < sizeof(State_Header) ||
+		memcmp(header->magic, state_magic, sizeof(state_magic)) != 0 ||
+		header->version != STATE_VERSION ||
+		header->layout != state_layout ||
+		header->size != state_size ||
+		size < state_size)
+		return false;
+	
+	// Read regions
+	const uint8_t *p = (const uint8_t*)blob + sizeof(State_Header);
+	for (size_t i = 0; i < state_modules; i++)
+	{
+		for (size_t j = 0; j < state_module[i].regions; j++)
+		{
+			const State_Region *region = &state_module[i].region[j];
+			memcpy(region->data, p, region->size);
+			p += STATE_PAD(region->size);
+		}
+	}
+	
+	// Rebuild derived state once every region is in place
+	for (size_t i = 0; i < state_modules; i++)
+		if (state_module[i].load != NULL)
+			state_module[i].load();
+	return true;
+}
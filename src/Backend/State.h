@@ -0,0 +1,42 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+// State constants
+#define STATE_MODULES 16
+
+// State blob
+// A 16 byte header ("SCPS", the format version, a hash of the registered layout and the blob size)
+// followed by every registered region in registration order, each padded to a multiple of 4 bytes.
+// Blobs hold pointers, so they're only valid for the executable and run that saved them
+#define STATE_VERSION 1
+
+typedef struct
+{
+	uint8_t magic[4];
+	uint32_t version;
+	uint32_t layout; // Hash of the size of every region, so blobs from a different layout are refused
+	uint32_t size;   // Size of the blob including this header
+} State_Header;
+
+// State regions
+typedef struct
+{
+	void *data;
+	size_t size;
+} State_Region;
+
+#define STATE_REGION(x) { &(x), sizeof(x) }
+
+// State interface
+// Modules register a table of their mutable regions once, along with an optional function that's
+// called after every load to rebuild whatever they derive from them (such as dirtying the renderer).
+// The C stack isn't part of the state, so a state must be loaded from the same point in the game
+// loop and the same game mode it was saved from, such as the start of a level frame
+bool State_Register(const State_Region *region, size_t regions, void (*load)());
+
+size_t State_GetSize();
+size_t State_Save(void *blob, size_t size); // Returns the size of the blob, or 0 if it doesn't fit
+bool State_Load(const void *blob, size_t size);
@@ -0,0 +1,192 @@
+#include "Tile.h"
+
+#include <string.h>
+
+// SCP_TILE_PORTABLE forces the portable paths, so they can be tested where SIMD is available
+#if defined(SCP_TILE_PORTABLE)
+#elif defined(__SSE2__)
+	#include <emmintrin.h>
+	#define TILE_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+	#include <arm_neon.h>
+	#define TILE_NEON
+#endif
+
+// Portable state
+static uint16_t tile_unpack_lut[0x100]; // Pixel pair in memory order
+
+// Tile interface
+void Tile_Init()
+{
+	// Build nibble unpack table for the portable path
+	for (size_t i = 0; i < 0x100; i++)
+	{
+		uint8_t pair[2] = { (uint8_t)(i >> 4), (uint8_t)(i & 0x0F) };
+		memcpy(&tile_unpack_lut[i], pair, 2);
+	}
+}
+
+void Tile_Unpack(uint8_t *dst, const uint8_t *src, size_t len)
+{
+#if defined(TILE_SSE2)
+	const __m128i mask = _mm_set1_epi8(0x0F);
+	for (; len >= 16; len -= 16, src += 16, dst += 32)
+	{
+		// Split nibbles and interleave them, high nibble first
+		__m128i v = _mm_loadu_si128((const __m128i*)src);
+		__m128i hi = _mm_and_si128(_mm_srli_epi16(v, 4), mask);
+		__m128i lo = _mm_and_si128(v, mask);
+		_mm_storeu_si128((__m128i*)(dst +  0), _mm_unpacklo_epi8(hi, lo));
+		_mm_storeu_si128((__m128i*)(dst + 16), _mm_unpackhi_epi8(hi, lo));
+	}
+#elif defined(TILE_NEON)
+	const uint8x16_t mask = vdupq_n_u8(0x0F);
+	for (; len >= 16; len -= 16, src += 16, dst += 32)
+	{
+		// Split nibbles and interleave them, high nibble first
+		uint8x16_t v = vld1q_u8(src);
+		uint8x16x2_t out;
+		out.val[0] = vshrq_n_u8(v, 4);
+		out.val[1] = vandq_u8(v, mask);
+		vst2q_u8(dst, out);
+	}
+#endif
+	// Portable path, also handles any remainder
+	for (; len >= 2; len -= 2, src += 2, dst += 4)
+	{
+		uint16_t v[2] = { tile_unpack_lut[src[0]], tile_unpack_lut[src[1]] };
+		memcpy(dst, v, 4);
+	}
+	if (len != 0)
+		memcpy(dst, &tile_unpack_lut[*src], 2);
+}
+
+void Tile_Expand(uint8_t *dst, size_t pitch, const uint8_t *src, uint8_t palette, bool x_flip, bool y_flip)
+{
+#if defined(TILE_SSE2)
+	const __m128i pal = _mm_set1_epi8((char)palette);
+	
+	// Each vector holds two rows
+	__m128i r[4];
+	for (size_t i = 0; i < 4; i++)
+		r[i] = _mm_loadu_si128((const __m128i*)(src + (i << 4)));
+	
+	if (x_flip)
+	{
+		// Reverse bytes within each row
+		for (size_t i = 0; i < 4; i++)
+		{
+			__m128i v = _mm_shufflelo_epi16(r[i], _MM_SHUFFLE(0, 1, 2, 3));
+			v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(0, 1, 2, 3));
+			r[i] = _mm_or_si128(_mm_srli_epi16(v, 8), _mm_slli_epi16(v, 8));
+		}
+	}
+	if (y_flip)
+	{
+		// Reverse row order, swapping the rows held within each vector
+		for (size_t i = 0; i < 4; i++)
+			r[i] = _mm_shuffle_epi32(r[i], _MM_SHUFFLE(1, 0, 3, 2));
+		__m128i t;
+		t = r[0]; r[0] = r[3]; r[3] = t;
+		t = r[1]; r[1] = r[2]; r[2] = t;
+	}
+	
+	for (size_t i = 0; i < 4; i++, dst += pitch << 1)
+	{
+		__m128i v = _mm_or_si128(r[i], pal);
+		_mm_storel_epi64((__m128i*)dst, v);
+		_mm_storel_epi64((__m128i*)(dst + pitch), _mm_unpackhi_epi64(v, v));
+	}
+#elif defined(TILE_NEON)
+	const uint8x16_t pal = vdupq_n_u8(palette);
+	
+	// Each vector holds two rows
+	uint8x16_t r[4];
+	for (size_t i = 0; i < 4; i++)
+		r[i] = vld1q_u8(src + (i << 4));
+	
+	if (x_flip)
+	{
+		// Reverse bytes within each row
+		for (size_t i = 0; i < 4; i++)
+			r[i] = vrev64q_u8(r[i]);
+	}
+	if (y_flip)
+	{
+		// Reverse row order, swapping the rows held within each vector
+		for (size_t i = 0; i < 4; i++)
+			r[i] = vextq_u8(r[i], r[i], 8);
+		uint8x16_t t;
+		t = r[0]; r[0] = r[3]; r[3] = t;
+		t = r[1]; r[1] = r[2]; r[2] = t;
+	}
+	
+	for (size_t i = 0; i < 4; i++, dst += pitch << 1)
+	{
+		uint8x16_t v = vorrq_u8(r[i], pal);
+		vst1_u8(dst, vget_low_u8(v));
+		vst1_u8(dst + pitch, vget_high_u8(v));
+	}
+#else
+	// Portable path, one row at a time
+	if (y_flip)
+	{
+		src += TILE_SIZE_8 - 8;
+		for (size_t i = 0; i < 8; i++, src -= 8, dst += pitch)
+			Tile_ExpandRow(dst, src, palette, x_flip);
+	}
+	else
+	{
+		for (size_t i = 0; i < 8; i++, src += 8, dst += pitch)
+			Tile_ExpandRow(dst, src, palette, x_flip);
+	}
+#endif
+}
+
+void Tile_ExpandRow(uint8_t *dst, const uint8_t *src, uint8_t attr, bool x_flip)
+{
+	// Treat the row as two words, none of the OR can carry between pixels
+	uint32_t v[2];
+	uint32_t attr_or = attr * 0x01010101U;
+	memcpy(v, src, 8);
+	
+	if (x_flip)
+	{
+		uint32_t t = v[0];
+		v[0] = v[1];
+		v[1] = t;
+		for (size_t i = 0; i < 2; i++)
+			v[i] = (v[i] >> 24) | ((v[i] >> 8) & 0x0000FF00) | ((v[i] << 8) & 0x00FF0000) | (v[i] << 24);
+	}
+	
+	v[0] |= attr_or;
+	v[1] |= attr_or;
+	memcpy(dst, v, 8);
+}
+
+// Scalar reference implementations
+void Tile_UnpackRef(uint8_t *dst, const uint8_t *src, size_t len)
+{
+	while (len-- > 0)
+	{
+		*dst++ = (*src & 0xF0) >> 4;
+		*dst++ = (*src & 0x0F) >> 0;
+		src++;
+	}
+}
+
+void Tile_ExpandRef(uint8_t *dst, size_t pitch, const uint8_t *src, uint8_t palette, bool x_flip, bool y_flip)
+{
+	for (size_t k = 0; k < 8; k++, dst += pitch)
+	{
+		const uint8_t *rowp = src + ((y_flip ? (7 - k) : k) << 3);
+		for (size_t l = 0; l < 8; l++)
+			dst[l] = rowp[x_flip ? (7 - l) : l] | palette;
+	}
+}
+
+void Tile_ExpandRowRef(uint8_t *dst, const uint8_t *src, uint8_t attr, bool x_flip)
+{
+	for (size_t i = 0; i < 8; i++)
+		dst[i] = src[x_flip ? (7 - i) : i] | attr;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+// Tile constants
+#define TILE_SIZE_4 0x20 // Bytes per 8x8 4bpp pattern
+#define TILE_SIZE_8 0x40 // Bytes per 8x8 8bpp pattern
+
+// Tile interface
+void Tile_Init();
+
+// Unpacks len bytes of 4bpp pixels (high nibble first) to 8bpp
+void Tile_Unpack(uint8_t *dst, const uint8_t *src, size_t len);
+// Copies an 8bpp pattern to rows pitch bytes apart, ORing the palette into every pixel and applying flips
+void Tile_Expand(uint8_t *dst, size_t pitch, const uint8_t *src, uint8_t palette, bool x_flip, bool y_flip);
+// Copies a single 8 pixel row of an 8bpp pattern, ORing attr into every pixel
+void Tile_ExpandRow(uint8_t *dst, const uint8_t *src, uint8_t attr, bool x_flip);
+
+// Scalar reference implementations
+void Tile_UnpackRef(uint8_t *dst, const uint8_t *src, size_t len);
+void Tile_ExpandRef(uint8_t *dst, size_t pitch, const uint8_t *src, uint8_t palette, bool x_flip, bool y_flip);
+void Tile_ExpandRowRef(uint8_t *dst, const uint8_t *src, uint8_t attr, bool x_flip);
@@ -35,3 +35,35 @@ uint32_t Timer_GetTicks(void)
 {
 	return ticks;
 }
+
+uint32_t Timer_GetMicros(void)
+{
+	// Combine the tick count with the counter's progress towards the next tick, retrying
+	// if a tick happened in between
+	uint32_t tick, value;
+	do
+	{
+		tick = ticks;
+		value = TIMER_VALUE(2);
+	} while (tick != ticks);
+	
+	return tick * (1000000 / TIMER_RATE) + (uint32_t)(((uint64_t)value * 1000000) / (F_CPU / 8));
+}
+
+uint32_t Timer_GetCounter(void)
+{
+	// Count at the timer's input clock
+	uint32_t tick, value;
+	do
+	{
+		tick = ticks;
+		value = TIMER_VALUE(2);
+	} while (tick != ticks);
+	
+	return tick * ((F_CPU / 8) / TIMER_RATE) + value;
+}
+
+uint32_t Timer_GetCounterRate(void)
+{
+	return ((F_CPU / 8) / TIMER_RATE) * TIMER_RATE;
+}
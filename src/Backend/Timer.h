@@ -6,3 +6,9 @@
 // Timer interface
 void Timer_Init(void);
 uint32_t Timer_GetTicks(void);
+uint32_t Timer_GetMicros(void);
+
+// Free-running counter for timing short spans, at Timer_GetCounterRate counts per second
+// Only differences between counts are meaningful, as the counter wraps
+uint32_t Timer_GetCounter(void);
+uint32_t Timer_GetCounterRate(void);
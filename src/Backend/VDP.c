@@ -1,6 +1,9 @@
 #include "VDP.h"
 
 #include "MegaDrive.h"
+#include "Tile.h"
+#include "Profile.h"
+#include "State.h"
 
 #include <stdio.h>
 #include <string.h>
@@ -13,6 +16,12 @@
 
 // VDP constants
 #define VDP_DIRTY_HEIGHT 128
+#define VDP_PAGE_SIZE 0x100
+
+#ifndef SCP_PRIMITIVE_SIZE
+	#define SCP_PRIMITIVE_SIZE 0x10000
+#endif
+#define VDP_PRIMITIVE_SIZE SCP_PRIMITIVE_SIZE
 
 static const uint8_t VDP_COLLEVEL_8[] = {
 	0,
@@ -36,18 +45,33 @@ static const uint16_t VDP_COLLEVEL_5[] = {
 	VDP_COLLEVEL_8[7] * 31 / 255
 };
 
+// Every 9-bit colour, indexed as 0bBBBGGGRRR
+#define VDP_MD_COLOURS 0x200
+#define VDP_COLOUR_INDEX(cv) ((((cv) & 0x00E) >> 1) | (((cv) & 0x0E0) >> 2) | (((cv) & 0xE00) >> 3))
+
+// Sprite pattern cache, one 4bpp texture page of 32x32 patterns, column by column
+#define VDP_SPRITE_X     320
+#define VDP_SPRITE_SLOTS (32 * 32)
+#define VDP_SPRITE_KEYS  ((TILE_PATTERN_AND + 1) << 2) // Pattern and flips
+
 // VDP internal state
 static ALIGNED4 uint8_t vdp_vram[VRAM_SIZE];
 static ALIGNED4 uint8_t vdp_vram_8[VRAM_SIZE * 2];
 static uint8_t *vdp_vram_p;
 
-static enum
+typedef enum
 {
 	VDPPlot_Null,
 	VDPPlot_PlaneA,
 	VDPPlot_PlaneB,
 	VDPPlot_Other,
-} vdp_vram_plot;
+	VDPPlot_Mixed, // Page straddles a region boundary
+} VDPPlot;
+
+static VDPPlot vdp_vram_plot;
+
+static uint8_t vdp_vram_page[VRAM_SIZE / VDP_PAGE_SIZE];
+static bool vdp_vram_page_dirty;
 
 static uint8_t vdp_vram_dirty[VRAM_SIZE / (VDP_DIRTY_HEIGHT * 4)];
 static uint8_t vdp_vram_plane_dirty[2][PLANE_WIDTH * PLANE_HEIGHT];
@@ -55,6 +79,11 @@ static uint8_t vdp_vram_plane_dirty[2][PLANE_WIDTH * PLANE_HEIGHT];
 static uint16_t vdp_cram[16 * 4];
 static uint16_t *vdp_cram_p;
 
+static uint16_t vdp_colour_lut[VDP_MD_COLOURS];
+static uint16_t vdp_cram_fmt[16 * 4];
+static uint8_t vdp_cram_dirty[16 * 4];
+static bool vdp_cram_changed;
+
 static size_t vdp_plane_a_location, vdp_plane_b_location, vdp_sprite_location, vdp_hscroll_location;
 static size_t vdp_plane_w, vdp_plane_h, vdp_plane_size;
 static uint8_t vdp_background_colour;
@@ -67,6 +96,28 @@ static MD_Vector vdp_hint, vdp_vint;
 
 static unsigned int vdp_last_time;
 
+static VDP_Stats vdp_stats;
+
+static unsigned int vdp_render_interval, vdp_render_count;
+
+// Sprite pattern cache state
+static uint16_t vdp_sprite_slot[VDP_SPRITE_KEYS]; // Slot + 1 holding each key, or 0
+static uint16_t vdp_sprite_key[VDP_SPRITE_SLOTS]; // Key + 1 held by each slot, or 0
+static uint32_t vdp_sprite_used[VDP_SPRITE_SLOTS]; // Frame each slot was last drawn in
+static uint32_t vdp_sprite_frame;
+static size_t vdp_sprite_hand;
+
+static ALIGNED4 uint8_t vdp_sprite_stage[VDP_SPRITE_SLOTS][TILE_SIZE_4];
+static uint16_t vdp_sprite_stage_slot[VDP_SPRITE_SLOTS];
+static size_t vdp_sprite_stages;
+
+// Sprite limit state
+static VDPSpriteLimit vdp_sprite_limit;
+
+static uint8_t vdp_line_sprites[SCREEN_HEIGHT];
+static uint16_t vdp_line_cells[SCREEN_HEIGHT];
+static uint8_t vdp_line_cut[SCREEN_HEIGHT];
+
 // GPU state
 #define GFX_OTLEN 8
 enum
@@ -79,6 +130,14 @@ enum
 	VDPOTLEN_BG
 };
 
+// Plane band, a run of lines sharing a scroll value
+typedef struct
+{
+	int16_t hscroll;
+	uint16_t sy, h;
+	uint8_t vy;
+} VDP_Band;
+
 static struct GpuState
 {
 	// Environments
@@ -87,11 +146,58 @@ static struct GpuState
 	
 	// Buffers
 	u_long ot[1 + GFX_OTLEN]; // Ordering table
-	uint8_t pri[0x10000]; // Primitive buffer
+	uint8_t pri[VDP_PRIMITIVE_SIZE]; // Primitive buffer
 	uint8_t *prip;
 } gpu_state[2];
 static struct GpuState *gpu_statep;
 
+// Primitive arena state
+// Layers are drawn from the most important down, and once the buffer runs out the layer being drawn
+// and every one after it are dropped whole
+static bool vdp_pri_full;
+static size_t vdp_pri_max;
+
+static u_long vdp_pri_mark_ot[1 + GFX_OTLEN];
+static uint8_t *vdp_pri_mark;
+static size_t vdp_pri_mark_primitives;
+
+static u_long vdp_pri_sink[8]; // Written instead of the buffer once it's run out
+
+// Plane state
+static VDP_Band vdp_band[2][SCREEN_HEIGHT];
+
+// Saved state
+static const State_Region vdp_state[] = {
+	STATE_REGION(vdp_vram),
+	STATE_REGION(vdp_vram_p),
+	STATE_REGION(vdp_vram_plot),
+	STATE_REGION(vdp_cram),
+	STATE_REGION(vdp_cram_p),
+	STATE_REGION(vdp_plane_a_location),
+	STATE_REGION(vdp_plane_b_location),
+	STATE_REGION(vdp_sprite_location),
+	STATE_REGION(vdp_hscroll_location),
+	STATE_REGION(vdp_plane_w),
+	STATE_REGION(vdp_plane_h),
+	STATE_REGION(vdp_plane_size),
+	STATE_REGION(vdp_background_colour),
+	STATE_REGION(vdp_vscroll_a),
+	STATE_REGION(vdp_vscroll_b),
+	STATE_REGION(vdp_hint_pos),
+};
+
+static void VDP_LoadState()
+{
+	// Deconstruct all of VRAM and redraw both planes again
+	memset(vdp_vram_dirty, 1, sizeof(vdp_vram_dirty));
+	memset(vdp_vram_plane_dirty, 1, sizeof(vdp_vram_plane_dirty));
+	vdp_vram_page_dirty = true;
+	
+	// Convert all of CRAM again
+	memset(vdp_cram_dirty, 1, sizeof(vdp_cram_dirty));
+	vdp_cram_changed = true;
+}
+
 // VDP interface
 int VDP_Init(const MD_Header *header)
 {
@@ -117,6 +223,13 @@ int VDP_Init(const MD_Header *header)
 	// Select GPU state
 	gpu_statep = &gpu_state[0];
 	
+	// Initialize tile kernels
+	Tile_Init();
+	
+	// Build colour table
+	for (size_t i = 0; i < VDP_MD_COLOURS; i++)
+		vdp_colour_lut[i] = 0x8000 | (VDP_COLLEVEL_5[i >> 6] << 10) | (VDP_COLLEVEL_5[(i >> 3) & 7] << 5) | VDP_COLLEVEL_5[i & 7];
+	
 	// Initialize VDP state
 	vdp_plane_a_location = 0;
 	vdp_plane_b_location = 0;
@@ -128,29 +241,77 @@ int VDP_Init(const MD_Header *header)
 	vdp_vscroll_a = 0;
 	vdp_vscroll_b = 0;
 	vdp_hint_pos = -1;
+	vdp_vram_page_dirty = true;
+	memset(vdp_cram_dirty, 1, sizeof(vdp_cram_dirty));
+	vdp_cram_changed = true;
+	
+	vdp_render_interval = 1;
+	vdp_render_count = 0;
+	vdp_sprite_limit = VDPSpriteLimit_None;
 	
 	vdp_hint = header->h_interrupt;
 	vdp_vint = header->v_interrupt;
 	
+	State_Register(vdp_state, sizeof(vdp_state) / sizeof(*vdp_state), VDP_LoadState);
+	
 	// Enable display output
 	SetDispMask(1);
 	
 	return 0;
 }
 
-void VDP_SeekVRAM(size_t offset)
+static VDPPlot VDP_ClassifyVRAM(size_t offset)
 {
-	vdp_vram_p = vdp_vram + offset;
 	if (offset >= (vdp_plane_a_location) && offset < (vdp_plane_a_location + vdp_plane_size))
-		vdp_vram_plot = VDPPlot_PlaneA;
+		return VDPPlot_PlaneA;
 	else if (offset >= (vdp_plane_b_location) && offset < (vdp_plane_b_location + vdp_plane_size))
-		vdp_vram_plot = VDPPlot_PlaneB;
+		return VDPPlot_PlaneB;
 	else if (offset >= (vdp_sprite_location) && offset < (vdp_sprite_location + SPRITES_SIZE))
-		vdp_vram_plot = VDPPlot_Other;
+		return VDPPlot_Other;
 	else if (offset >= (vdp_hscroll_location) && offset < (vdp_hscroll_location + (SCREEN_HEIGHT * 4)))
-		vdp_vram_plot = VDPPlot_Other;
+		return VDPPlot_Other;
 	else
-		vdp_vram_plot = VDPPlot_Null;
+		return VDPPlot_Null;
+}
+
+static void VDP_UpdatePageMap()
+{
+	// Get region boundaries
+	const size_t bound[] = {
+		vdp_plane_a_location, vdp_plane_a_location + vdp_plane_size,
+		vdp_plane_b_location, vdp_plane_b_location + vdp_plane_size,
+		vdp_sprite_location,  vdp_sprite_location + SPRITES_SIZE,
+		vdp_hscroll_location, vdp_hscroll_location + (SCREEN_HEIGHT * 4),
+	};
+	
+	// Classify each page, falling back to a full check for pages split by a boundary
+	for (size_t i = 0; i < (VRAM_SIZE / VDP_PAGE_SIZE); i++)
+	{
+		size_t page = i * VDP_PAGE_SIZE;
+		VDPPlot plot = VDP_ClassifyVRAM(page);
+		for (size_t j = 0; j < sizeof(bound) / sizeof(*bound); j++)
+		{
+			if (bound[j] > page && bound[j] < (page + VDP_PAGE_SIZE))
+			{
+				plot = VDPPlot_Mixed;
+				break;
+			}
+		}
+		vdp_vram_page[i] = plot;
+	}
+	vdp_vram_page_dirty = false;
+}
+
+void VDP_SeekVRAM(size_t offset)
+{
+	vdp_vram_p = vdp_vram + offset;
+	
+	// Classify region from page map
+	if (vdp_vram_page_dirty)
+		VDP_UpdatePageMap();
+	vdp_vram_plot = vdp_vram_page[(offset / VDP_PAGE_SIZE) & ((VRAM_SIZE / VDP_PAGE_SIZE) - 1)];
+	if (vdp_vram_plot == VDPPlot_Mixed)
+		vdp_vram_plot = VDP_ClassifyVRAM(offset);
 }
 
 static void VDP_DirtyVRAM(size_t a, size_t b)
@@ -222,6 +383,17 @@ void VDP_WriteVRAM(const uint8_t *data, size_t len)
 	VDP_DirtyVRAM(vdp_vram_start - vdp_vram, vdp_vram_p - vdp_vram);
 }
 
+void VDP_WriteVRAMStrided(const uint8_t *data, size_t len, size_t count, size_t src_stride, size_t dst_stride)
+{
+	// Write rows, dirtying the whole span once
+	if (count == 0)
+		return;
+	uint8_t *vdp_vram_start = vdp_vram_p;
+	for (size_t i = 0; i < count; i++, data += src_stride, vdp_vram_p += dst_stride)
+		memcpy(vdp_vram_p, data, len);
+	VDP_DirtyVRAM(vdp_vram_start - vdp_vram, (vdp_vram_p - dst_stride + len) - vdp_vram);
+}
+
 void VDP_FillVRAM(uint8_t data, size_t len)
 {
 	uint8_t *vdp_vram_start = vdp_vram_p;
@@ -230,6 +402,32 @@ void VDP_FillVRAM(uint8_t data, size_t len)
 	VDP_DirtyVRAM(vdp_vram_start - vdp_vram, vdp_vram_p - vdp_vram);
 }
 
+void VDP_WritePlaneRect(size_t location, size_t x, size_t y, size_t w, size_t h, const uint16_t *data)
+{
+	// Split rectangle where it wraps around the plane
+	for (size_t j = 0; j < h;)
+	{
+		size_t py = (y + j) % vdp_plane_h;
+		size_t rh = vdp_plane_h - py;
+		if (rh > (h - j))
+			rh = h - j;
+		
+		for (size_t i = 0; i < w;)
+		{
+			size_t px = (x + i) % vdp_plane_w;
+			size_t rw = vdp_plane_w - px;
+			if (rw > (w - i))
+				rw = w - i;
+			
+			// Write piece
+			VDP_SeekVRAM(location + (((py * vdp_plane_w) + px) << 1));
+			VDP_WriteVRAMStrided((const uint8_t*)(data + (j * w) + i), rw << 1, rh, w << 1, vdp_plane_w << 1);
+			i += rw;
+		}
+		j += rh;
+	}
+}
+
 void VDP_SeekCRAM(size_t offset)
 {
 	vdp_cram_p = vdp_cram + offset;
@@ -237,34 +435,54 @@ void VDP_SeekCRAM(size_t offset)
 
 void VDP_WriteCRAM(const uint16_t *data, size_t len)
 {
-	memcpy(vdp_cram_p, data, len << 1);
-	vdp_cram_p += len;
+	// Only dirty entries that change, as palettes are rewritten whole every frame
+	for (; len != 0; len--, vdp_cram_p++)
+	{
+		uint16_t cv = *data++;
+		if (*vdp_cram_p != cv)
+		{
+			*vdp_cram_p = cv;
+			vdp_cram_dirty[vdp_cram_p - vdp_cram] = 1;
+			vdp_cram_changed = true;
+		}
+	}
 }
 
 void VDP_FillCRAM(uint16_t data, size_t len)
 {
-	while (len-- > 0)
-		*vdp_cram_p++ = data;
+	for (; len != 0; len--, vdp_cram_p++)
+	{
+		if (*vdp_cram_p != data)
+		{
+			*vdp_cram_p = data;
+			vdp_cram_dirty[vdp_cram_p - vdp_cram] = 1;
+			vdp_cram_changed = true;
+		}
+	}
 }
 
 void VDP_SetPlaneALocation(size_t loc)
 {
 	vdp_plane_a_location = loc;
+	vdp_vram_page_dirty = true;
 }
 
 void VDP_SetPlaneBLocation(size_t loc)
 {
 	vdp_plane_b_location = loc;
+	vdp_vram_page_dirty = true;
 }
 
 void VDP_SetSpriteLocation(size_t loc)
 {
 	vdp_sprite_location = loc;
+	vdp_vram_page_dirty = true;
 }
 
 void VDP_SetHScrollLocation(size_t loc)
 {
 	vdp_hscroll_location = loc;
+	vdp_vram_page_dirty = true;
 }
 
 void VDP_SetPlaneSize(size_t w, size_t h)
@@ -272,6 +490,7 @@ void VDP_SetPlaneSize(size_t w, size_t h)
 	vdp_plane_w = w;
 	vdp_plane_h = h;
 	vdp_plane_size = w * h * 2;
+	vdp_vram_page_dirty = true;
 }
 
 void VDP_SetBackgroundColour(uint8_t index)
@@ -293,77 +512,340 @@ void VDP_SetHIntPosition(int16_t pos)
 // VDP rendering
 static void *VDP_AllocPrim(size_t size, size_t index)
 {
+	// Don't overrun the buffer, the layer being drawn is dropped once it's done
+	if (vdp_pri_full || size > (size_t)((gpu_statep->pri + VDP_PRIMITIVE_SIZE) - gpu_statep->prip))
+	{
+		vdp_pri_full = true;
+		return vdp_pri_sink;
+	}
+	
 	// Allocate and link primitive of given size
 	void *pri = gpu_statep->prip;
 	gpu_statep->prip += size;
 	addPrim(&gpu_statep->ot[1 + index], pri);
+	vdp_stats.primitives++;
 	return pri;
 }
 
-static void VDP_DrawPlaneSeg(const int16_t hscroll, const size_t *index, size_t indices, uint16_t sy, uint16_t vy, uint16_t h, uint16_t pu)
+static void VDP_BeginLayers()
 {
-	/*
-	int16_t sx = -((uint16_t)(-hscroll) & 0x7F);
-	x += ((uint16_t)(-hscroll) & 0x180) >> 1;
-	while (1)
+	// Mark where the next layers start
+	memcpy(vdp_pri_mark_ot, gpu_statep->ot, sizeof(vdp_pri_mark_ot));
+	vdp_pri_mark = gpu_statep->prip;
+	vdp_pri_mark_primitives = vdp_stats.primitives;
+}
+
+static void VDP_EndLayers(size_t layers)
+{
+	// Drop the layers whole if the buffer ran out while drawing them
+	if (vdp_pri_full)
 	{
-		for (size_t i = 0; i < 2; i++)
+		memcpy(gpu_statep->ot, vdp_pri_mark_ot, sizeof(vdp_pri_mark_ot));
+		gpu_statep->prip = vdp_pri_mark;
+		vdp_stats.primitives = vdp_pri_mark_primitives;
+		vdp_stats.dropped += layers;
+	}
+}
+
+static void VDP_ExpandSprite(uint8_t *dst, const uint8_t *src, bool x_flip, bool y_flip)
+{
+	// Convert an 8x8 4bpp pattern from high nibble first to low nibble first, applying flips
+	// Flipping a row horizontally only has to reverse its bytes, as that also swaps their nibbles
+	for (size_t y = 0; y < 8; y++, dst += 4)
+	{
+		const uint8_t *srcp = src + ((y_flip ? (7 - y) : y) << 2);
+		if (x_flip)
 		{
-			// Draw segment
-			SPRT *sprt = VDP_AllocPrim(sizeof(SPRT), index[i]);
-			setSprt(sprt);
-			sprt->x0 = sx;
-			sprt->y0 = sy;
-			sprt->u0 = (x << 1) & 0xFF;
-			sprt->v0 = vy;
-			sprt->w = 128;
-			sprt->h = h;
-			sprt->clut = 64 * 511;
-			setRGB0(sprt, 128, 128, 128);
+			dst[0] = srcp[3];
+			dst[1] = srcp[2];
+			dst[2] = srcp[1];
+			dst[3] = srcp[0];
+		}
+		else
+		{
+			for (size_t x = 0; x < 4; x++)
+				dst[x] = (uint8_t)((srcp[x] >> 4) | (srcp[x] << 4));
+		}
+	}
+}
+
+static void VDP_InvalidateSprites()
+{
+	// Drop cached patterns in dirty VRAM, before the dirty flags are cleared by the transfer
+	for (size_t i = 0; i < (VRAM_SIZE / (VDP_DIRTY_HEIGHT * 4)); i++)
+	{
+		if (!vdp_vram_dirty[i])
+			continue;
+		
+		size_t key = i * ((VDP_DIRTY_HEIGHT * 4 / TILE_SIZE_4) << 2);
+		for (size_t j = 0; j < ((VDP_DIRTY_HEIGHT * 4 / TILE_SIZE_4) << 2); j++, key++)
+		{
+			if (vdp_sprite_slot[key] != 0)
+			{
+				vdp_sprite_key[vdp_sprite_slot[key] - 1] = 0;
+				vdp_sprite_slot[key] = 0;
+			}
+		}
+	}
+}
+
+static int VDP_CacheSprite(uint16_t pattern, bool x_flip, bool y_flip)
+{
+	// Use cached pattern
+	size_t key = ((size_t)pattern << 2) | (y_flip << 1) | x_flip;
+	if (vdp_sprite_slot[key] != 0)
+	{
+		size_t slot = vdp_sprite_slot[key] - 1;
+		vdp_sprite_used[slot] = vdp_sprite_frame;
+		return slot;
+	}
+	
+	// Take the next slot that isn't drawn this frame, giving up if there's none
+	for (size_t i = 0; i < VDP_SPRITE_SLOTS; i++)
+	{
+		size_t slot = vdp_sprite_hand;
+		vdp_sprite_hand = (vdp_sprite_hand + 1) % VDP_SPRITE_SLOTS;
+		if (vdp_sprite_used[slot] == vdp_sprite_frame)
+			continue;
+		
+		if (vdp_sprite_key[slot] != 0)
+			vdp_sprite_slot[vdp_sprite_key[slot] - 1] = 0;
+		vdp_sprite_key[slot] = key + 1;
+		vdp_sprite_slot[key] = slot + 1;
+		vdp_sprite_used[slot] = vdp_sprite_frame;
+		
+		// Expand pattern now, it's transferred once the GPU is done with the last frame
+		VDP_ExpandSprite(vdp_sprite_stage[vdp_sprite_stages], vdp_vram + ((size_t)pattern * TILE_SIZE_4), x_flip, y_flip);
+		vdp_sprite_stage_slot[vdp_sprite_stages++] = slot;
+		vdp_stats.patterns++;
+		return slot;
+	}
+	return -1;
+}
+
+static void VDP_DrawSprites()
+{
+	// Start new frame of the cache
+	VDP_InvalidateSprites();
+	vdp_sprite_frame++;
+	vdp_sprite_stages = 0;
+	
+	memset(vdp_line_sprites, 0, sizeof(vdp_line_sprites));
+	memset(vdp_line_cells, 0, sizeof(vdp_line_cells));
+	memset(vdp_line_cut, 0, sizeof(vdp_line_cut));
+	
+	// Walk sprite link list
+	for (size_t sprites = 0, i = 0; sprites < SPRITES; sprites++)
+	{
+		// Get sprite values
+		const uint16_t *sprite = (const uint16_t*)(vdp_vram + vdp_sprite_location + (i << 3));
+		uint16_t sprite_sl = sprite[1];
+		uint8_t sprite_width = ((sprite_sl & SPRITE_SL_W_AND) >> SPRITE_SL_W_SHIFT) + 1;
+		uint8_t sprite_height = ((sprite_sl & SPRITE_SL_H_AND) >> SPRITE_SL_H_SHIFT) + 1;
+		uint8_t sprite_link = (sprite_sl & SPRITE_SL_L_AND) >> SPRITE_SL_L_SHIFT;
+		uint16_t sprite_tile = sprite[2];
+		int16_t sprite_x = (int16_t)((sprite[3] & SPRITE_X_AND) >> SPRITE_X_SHIFT) - 0x80;
+		int16_t sprite_y = (int16_t)((sprite[0] & SPRITE_Y_AND) >> SPRITE_Y_SHIFT) - 0x80;
+		
+		size_t index = (sprite_tile & TILE_PRIORITY_AND) ? VDPOTLEN_SP_PRI : VDPOTLEN_SP;
+		uint16_t clut = (64 * 511) + ((sprite_tile & TILE_PALETTE_AND) >> TILE_PALETTE_SHIFT);
+		bool y_flip = (sprite_tile & TILE_Y_FLIP_AND) != 0;
+		bool x_flip = (sprite_tile & TILE_X_FLIP_AND) != 0;
+		uint16_t pattern = (sprite_tile & TILE_PATTERN_AND) >> TILE_PATTERN_SHIFT;
+		
+		// Get cells drawn on each line, counting the sprite towards the limits of the lines on screen
+		// Sprites count even when they're off screen horizontally
+		uint8_t line_width[4 * 8];
+		bool cut = false;
+		
+		for (size_t y = 0; y < ((size_t)sprite_height << 3); y++)
+		{
+			line_width[y] = sprite_width;
+			int ly = sprite_y + (int)y;
+			if (ly < 0 || ly >= SCREEN_HEIGHT)
+				continue;
 			
-			// Set texture page
-			DR_TPAGE *tpage = VDP_AllocPrim(sizeof(DR_TPAGE), index[i]);
-			setDrawTPage(tpage, 1, 0, getTPage(1, 0, (x & ~0x7F) + (i << 8), pu));
+			uint8_t w = sprite_width;
+			if (vdp_line_sprites[ly] >= SPRITES_LINE)
+				w = 0;
+			else if (vdp_line_cells[ly] + w > CELLS_LINE)
+				w = (vdp_line_cells[ly] < CELLS_LINE) ? (CELLS_LINE - vdp_line_cells[ly]) : 0;
+			vdp_line_sprites[ly]++;
+			vdp_line_cells[ly] += sprite_width;
+			
+			if (w != sprite_width)
+			{
+				if (!vdp_line_cut[ly])
+					vdp_stats.line_overflow++;
+				vdp_line_cut[ly] = 1;
+				cut = true;
+				line_width[y] = w;
+			}
 		}
+		if (cut)
+			vdp_stats.sprite_overflow++;
+		bool clip = cut && vdp_sprite_limit == VDPSpriteLimit_Line;
 		
-		// Increment
-		sx += 128;
-		if (sx >= SCREEN_WIDTH)
+		// Write cells, which are ordered column by column and mirrored as a whole by the flips
+		for (uint8_t x = 0; x < sprite_width; x++)
+		{
+			int cx = sprite_x + (x << 3);
+			if (cx <= -8 || cx >= SCREEN_WIDTH)
+				continue;
+			
+			for (uint8_t y = 0; y < sprite_height; y++)
+			{
+				int cy = sprite_y + (y << 3);
+				if (cy <= -8 || cy >= SCREEN_HEIGHT)
+					continue;
+				
+				// Get lines of the cell that aren't cut off
+				uint8_t lines = 0xFF;
+				if (clip)
+				{
+					lines = 0;
+					for (size_t k = 0; k < 8; k++)
+						if (line_width[(y << 3) + k] > x)
+							lines |= 1 << k;
+					if (lines == 0)
+						continue;
+				}
+				
+				uint8_t col = x_flip ? (sprite_width - 1 - x) : x;
+				uint8_t row = y_flip ? (sprite_height - 1 - y) : y;
+				int slot = VDP_CacheSprite((pattern + (col * sprite_height) + row) & TILE_PATTERN_AND, x_flip, y_flip);
+				if (slot < 0)
+				{
+					vdp_stats.uncached++;
+					continue;
+				}
+				
+				if (lines == 0xFF)
+				{
+					// Draw whole cell
+					SPRT_8 *sprt = VDP_AllocPrim(sizeof(SPRT_8), index);
+					setSprt8(sprt);
+					sprt->x0 = cx;
+					sprt->y0 = cy;
+					sprt->u0 = (slot >> 5) << 3;
+					sprt->v0 = (slot & 31) << 3;
+					sprt->clut = clut;
+					setRGB0(sprt, 128, 128, 128);
+				}
+				else
+				{
+					// Draw each run of lines that aren't cut off
+					for (uint8_t k = 0; k < 8;)
+					{
+						if (!(lines & (1 << k)))
+						{
+							k++;
+							continue;
+						}
+						uint8_t ka = k;
+						while (k < 8 && (lines & (1 << k)))
+							k++;
+						
+						SPRT *sprt = VDP_AllocPrim(sizeof(SPRT), index);
+						setSprt(sprt);
+						sprt->x0 = cx;
+						sprt->y0 = cy + ka;
+						sprt->u0 = (slot >> 5) << 3;
+						sprt->v0 = ((slot & 31) << 3) + ka;
+						sprt->w = 8;
+						sprt->h = k - ka;
+						sprt->clut = clut;
+						setRGB0(sprt, 128, 128, 128);
+					}
+				}
+			}
+		}
+		
+		// Go to next sprite
+		if (sprite_link != 0 && sprite_link < SPRITES)
+			i = sprite_link;
+		else
 			break;
-		x = ((x + 64) & 0xFF) | 0x200;
 	}
-	*/
-	uint16_t ux = -hscroll & 0x1FE;
-	int16_t sx = -(hscroll & 1);
-	uint16_t lx = SCREEN_WIDTH + (hscroll & 1);
+	
+	// Set texture page, which is linked last so it's drawn first in both layers
+	static const size_t index_sp[] = { VDPOTLEN_SP, VDPOTLEN_SP_PRI };
+	for (size_t i = 0; i < 2; i++)
+	{
+		DR_TPAGE *tpage = VDP_AllocPrim(sizeof(DR_TPAGE), index_sp[i]);
+		setDrawTPage(tpage, 1, 0, getTPage(0, 0, VDP_SPRITE_X, 0));
+	}
+}
+
+static void VDP_UploadSprites()
+{
+	// Transfer patterns expanded this frame, merging runs of slots down the same column
+	for (size_t i = 0; i < vdp_sprite_stages;)
+	{
+		size_t slot = vdp_sprite_stage_slot[i];
+		size_t run = 1;
+		while ((i + run) < vdp_sprite_stages && vdp_sprite_stage_slot[i + run] == (slot + run) && ((slot + run) & 31) != 0)
+			run++;
+		
+		RECT sprite_rect = {VDP_SPRITE_X + ((slot >> 5) << 1), (slot & 31) << 3, 2, run << 3};
+		LoadImage(&sprite_rect, (u_long*)vdp_sprite_stage[i]);
+		vdp_stats.transfers++;
+		i += run;
+	}
+}
+
+static size_t VDP_GetBands(VDP_Band *band, const int16_t *hscroll, int16_t vscroll)
+{
+	// Split the screen into bands of lines sharing a scroll value, also splitting where the plane wraps vertically
+	size_t bands = 0;
+	uint8_t vy = vscroll;
+	
+	for (uint16_t sy = 0; sy < SCREEN_HEIGHT; sy++, vy++, hscroll += 2)
+	{
+		if (sy == 0 || *hscroll != band[bands - 1].hscroll || vy == 0)
+		{
+			band[bands].hscroll = *hscroll;
+			band[bands].sy = sy;
+			band[bands].vy = vy;
+			band[bands].h = 0;
+			bands++;
+		}
+		band[bands - 1].h++;
+	}
+	return bands;
+}
+
+static size_t VDP_DrawPlaneBand(const VDP_Band *band, size_t index, uint16_t page)
+{
+	// Draw the pieces of a band that lie in one texture page of the plane
+	uint16_t ux = -band->hscroll & 0x1FE;
+	int16_t sx = -(band->hscroll & 1);
+	uint16_t lx = SCREEN_WIDTH + (band->hscroll & 1);
+	size_t pieces = 0;
 	
 	while (1)
 	{
-		// Get segment width
+		// Get piece width
 		uint16_t width;
 		if (lx & 0xFF00)
 			width = 0x100 - (ux & 0xFE);
 		else
 			width = lx - (ux & 0xFE);
 		
-		uint16_t px = 512;
-		for (size_t i = 0; i < indices; i++, px = 768)
+		// Draw piece
+		if ((ux & 0x100) == page)
 		{
-			// Draw segment
-			SPRT *sprt = VDP_AllocPrim(sizeof(SPRT), index[i]);
+			SPRT *sprt = VDP_AllocPrim(sizeof(SPRT), index);
 			setSprt(sprt);
 			sprt->x0 = sx;
-			sprt->y0 = sy;
+			sprt->y0 = band->sy;
 			sprt->u0 = ux;
-			sprt->v0 = vy;
+			sprt->v0 = band->vy;
 			sprt->w = width;
-			sprt->h = h;
+			sprt->h = band->h;
 			sprt->clut = 64 * 511;
 			setRGB0(sprt, 128, 128, 128);
-			
-			// Set texture page
-			DR_TPAGE *tpage = VDP_AllocPrim(sizeof(DR_TPAGE), index[i]);
-			setDrawTPage(tpage, 1, 0, getTPage(1, 0, px + ((ux & 0x100) >> 1), pu));
+			pieces++;
 		}
 		
 		// Increment
@@ -373,143 +855,171 @@ static void VDP_DrawPlaneSeg(const int16_t hscroll, const size_t *index, size_t
 		if (sx >= SCREEN_WIDTH)
 			break;
 	}
+	return pieces;
 }
 
-static void VDP_DrawPlane(const int16_t *hscroll, const size_t *index, size_t indices, int16_t vscroll, uint16_t pu)
+static void VDP_DrawPlaneLayer(const VDP_Band *band, size_t bands, size_t index, uint16_t px, uint16_t pu)
 {
-	int16_t hscroll_v = *hscroll;
-	uint16_t sy_v = 0;
-	uint8_t vy_v = vscroll;
-	uint8_t vy = vy_v;
-	
-	for (uint16_t sy = 0; sy < SCREEN_HEIGHT; sy++)
+	// Draw the bands one texture page at a time
+	// Pieces of a layer never overlap, so only one texture page change is needed per page
+	for (uint16_t page = 0; page <= 0x100; page += 0x100)
 	{
-		// Check if hscroll has changed or we're crossing segs
-		if (*hscroll != hscroll_v || (sy != 0 && vy == 0))
+		size_t pieces = 0;
+		for (size_t i = 0; i < bands; i++)
+			pieces += VDP_DrawPlaneBand(&band[i], index, page);
+		
+		// Set texture page, which is linked last so it's drawn before the pieces
+		if (pieces != 0)
 		{
-			VDP_DrawPlaneSeg(hscroll_v, index, indices, sy_v, vy_v, sy - sy_v, pu);
-			hscroll_v = *hscroll;
-			sy_v = sy;
-			vy_v = vy;
+			DR_TPAGE *tpage = VDP_AllocPrim(sizeof(DR_TPAGE), index);
+			setDrawTPage(tpage, 1, 0, getTPage(1, 0, px + (page >> 1), pu));
 		}
-		
-		// Increment
-		vy++;
-		hscroll += 2;
 	}
+}
+
+static void VDP_FillBackground()
+{
+	// Fill screen with the background colour
+	uint16_t cv = vdp_cram[vdp_background_colour];
+	uint8_t r = (cv & 0x00E) >> 1;
+	uint8_t g = (cv & 0x0E0) >> 5;
+	uint8_t b = (cv & 0xE00) >> 9;
+	r = VDP_COLLEVEL_8[r];
+	g = VDP_COLLEVEL_8[g];
+	b = VDP_COLLEVEL_8[b];
 	
-	// Finish last seg
-	VDP_DrawPlaneSeg(hscroll_v, index, indices, sy_v, vy_v, SCREEN_HEIGHT - sy_v, pu);
+	TILE *bg_fill = VDP_AllocPrim(sizeof(TILE), GFX_OTLEN - 1);
+	setTile(bg_fill);
+	bg_fill->x0 = 0;
+	bg_fill->y0 = 0;
+	bg_fill->w = 240;
+	bg_fill->h = SCREEN_HEIGHT;
+	setRGB0(bg_fill, r, g, b);
+	
+	bg_fill = VDP_AllocPrim(sizeof(TILE), GFX_OTLEN - 1);
+	setTile(bg_fill);
+	bg_fill->x0 = 240;
+	bg_fill->y0 = 0;
+	bg_fill->w = SCREEN_WIDTH - 240;
+	bg_fill->h = SCREEN_HEIGHT;
+	setRGB0(bg_fill, r, g, b);
+}
+
+const VDP_Stats *VDP_GetStats()
+{
+	return &vdp_stats;
+}
+
+void VDP_SetRenderInterval(unsigned int interval)
+{
+	vdp_render_interval = interval;
+	vdp_render_count = 0;
+}
+
+void VDP_SetSpriteLimit(VDPSpriteLimit limit)
+{
+	vdp_sprite_limit = limit;
 }
 
 void VDP_Render()
 {
+	// Reset statistics
+	memset(&vdp_stats, 0, sizeof(vdp_stats));
+	
+	// Skip frame if it isn't due, without waiting for the display
+	// Writes made in skipped frames stay dirty until the next frame that's drawn
+	if (vdp_render_interval == 0 || ++vdp_render_count < vdp_render_interval)
+	{
+		vdp_vint();
+		return;
+	}
+	vdp_render_count = 0;
+	
+	PROFILE_BEGIN(VDP_Render);
+	PROFILE_BEGIN(VDP_Draw);
+	
 	// Flip GPU state
 	gpu_statep = (gpu_statep == &gpu_state[0]) ? &gpu_state[1] : &gpu_state[0];
 	
 	gpu_statep->prip = gpu_statep->pri;
 	ClearOTagR(gpu_statep->ot, 1 + GFX_OTLEN);
 	
-	// Update CRAM
-	uint16_t cram_fmt[4 * 16];
-	for (size_t i = 0; i < 4 * 16; i++)
+	// Convert changed CRAM entries
+	bool cram_upload = vdp_cram_changed;
+	if (vdp_cram_changed)
 	{
-		if (i & 0x0F)
+		for (size_t i = 0; i < 4 * 16; i++)
 		{
-			// Get colour values
-			uint16_t cv = vdp_cram[i];
-			uint8_t r = (cv & 0x00E) >> 1;
-			uint8_t g = (cv & 0x0E0) >> 5;
-			uint8_t b = (cv & 0xE00) >> 9;
+			if (!vdp_cram_dirty[i])
+				continue;
+			vdp_cram_dirty[i] = 0;
 			
-			// Get formatted colour
-			cram_fmt[i] = 0x8000 | (VDP_COLLEVEL_5[b] << 10) | (VDP_COLLEVEL_5[g] << 5) | VDP_COLLEVEL_5[r];
-		}
-		else
-		{
-			// Transparent
-			cram_fmt[i] = 0x0000;
+			// The first entry of each line is transparent
+			if (i & 0x0F)
+				vdp_cram_fmt[i] = vdp_colour_lut[VDP_COLOUR_INDEX(vdp_cram[i])];
+			else
+				vdp_cram_fmt[i] = 0x0000;
+			vdp_stats.colours++;
 		}
+		vdp_cram_changed = false;
 	}
 	
-	// Draw plane A
+	// Get bands of both planes
+	// When every line scrolls differently, each line is its own band, so there are at most 3 pieces per line
 	const int16_t *hscroll = (int16_t*)(vdp_vram + vdp_hscroll_location);
+	size_t bands_a = VDP_GetBands(vdp_band[0], &hscroll[0], vdp_vscroll_a);
+	size_t bands_b = VDP_GetBands(vdp_band[1], &hscroll[1], vdp_vscroll_b);
+	vdp_stats.bands = bands_a + bands_b;
 	
-	static const size_t index_fg[] = { VDPOTLEN_FG, VDPOTLEN_FG_PRI };
-	VDP_DrawPlane(&hscroll[0], index_fg, 2, vdp_vscroll_a, 0);
+	// Draw layers from the most important down, so the least important are dropped first
+	// Layers are in their own ordering table entries, so the order they're drawn in here doesn't matter
+	vdp_pri_full = false;
 	
-	static const size_t index_bg[] = { VDPOTLEN_BG, VDPOTLEN_BG_PRI };
-	VDP_DrawPlane(&hscroll[1], index_bg, 1, vdp_vscroll_b, 256);
+	VDP_BeginLayers();
+	VDP_FillBackground();
+	VDP_EndLayers(1);
 	
-	// Draw sprites
-	for (uint8_t i = 0;;)
-	{
-		// Get sprite values
-		const uint16_t *sprite = (const uint16_t*)(vdp_vram + vdp_sprite_location + ((size_t)i << 3));
-		uint16_t sprite_y = sprite[0];
-		uint16_t sprite_sl = sprite[1];
-		uint8_t sprite_width = (sprite_sl & SPRITE_SL_W_AND) >> SPRITE_SL_W_SHIFT;
-		uint8_t sprite_height = (sprite_sl & SPRITE_SL_H_AND) >> SPRITE_SL_H_SHIFT;
-		uint8_t sprite_link = (sprite_sl & SPRITE_SL_L_AND) >> SPRITE_SL_L_SHIFT;
-		uint16_t sprite_tile = sprite[2];
-		uint16_t sprite_x = sprite[3];
-		
-		// Write sprites
-		for (uint8_t x = 0; x <= sprite_width; x++)
-		{
-			TILE *tile = VDP_AllocPrim(sizeof(TILE), VDPOTLEN_SP);
-			setTile(tile);
-			tile->x0 = (int)sprite_x - 0x80 + (x << 3);
-			tile->y0 = (int)sprite_y - 0x80;
-			tile->w = 8;
-			tile->h = 8 + (sprite_height << 3);
-			setRGB0(tile, 255, 255, 255);
-		}
-		
-		// Go to next sprite
-		if (sprite_link != 0)
-			i = sprite_link;
-		else
-			break;
-	}
+	VDP_BeginLayers();
+	VDP_DrawSprites();
+	VDP_EndLayers(2);
 	
-	// Fill background
-	{
-		uint16_t cv = vdp_cram[vdp_background_colour];
-		uint8_t r = (cv & 0x00E) >> 1;
-		uint8_t g = (cv & 0x0E0) >> 5;
-		uint8_t b = (cv & 0xE00) >> 9;
-		r = VDP_COLLEVEL_8[r];
-		g = VDP_COLLEVEL_8[g];
-		b = VDP_COLLEVEL_8[b];
-		
-		TILE *bg_fill = VDP_AllocPrim(sizeof(TILE), GFX_OTLEN - 1);
-		setTile(bg_fill);
-		bg_fill->x0 = 0;
-		bg_fill->y0 = 0;
-		bg_fill->w = 240;
-		bg_fill->h = SCREEN_HEIGHT;
-		setRGB0(bg_fill, r, g, b);
-		
-		bg_fill = VDP_AllocPrim(sizeof(TILE), GFX_OTLEN - 1);
-		setTile(bg_fill);
-		bg_fill->x0 = 240;
-		bg_fill->y0 = 0;
-		bg_fill->w = SCREEN_WIDTH - 240;
-		bg_fill->h = SCREEN_HEIGHT;
-		setRGB0(bg_fill, r, g, b);
-	}
+	VDP_BeginLayers();
+	VDP_DrawPlaneLayer(vdp_band[0], bands_a, VDPOTLEN_FG_PRI, 768, 0);
+	VDP_EndLayers(1);
+	
+	VDP_BeginLayers();
+	VDP_DrawPlaneLayer(vdp_band[0], bands_a, VDPOTLEN_FG, 512, 0);
+	VDP_EndLayers(1);
+	
+	VDP_BeginLayers();
+	VDP_DrawPlaneLayer(vdp_band[1], bands_b, VDPOTLEN_BG, 512, 256);
+	VDP_EndLayers(1);
+	
+	// Update arena statistics
+	vdp_stats.arena = gpu_statep->prip - gpu_statep->pri;
+	if (vdp_stats.arena > vdp_pri_max)
+		vdp_pri_max = vdp_stats.arena;
+	vdp_stats.arena_max = vdp_pri_max;
+	
+	PROFILE_END(VDP_Draw);
+	PROFILE_BEGIN(VDP_VRAM);
 	
 	// Flush GPU
 	DrawSync(0);
 	
-	// Transfer formatted CRAM to VRAM
-	RECT cram_rect = {0, 511, 16 * 4, 1};
-	LoadImage(&cram_rect, (u_long*)cram_fmt);
+	// Transfer formatted CRAM to VRAM if it changed
+	if (cram_upload)
+	{
+		RECT cram_rect = {0, 511, 16 * 4, 1};
+		LoadImage(&cram_rect, (u_long*)vdp_cram_fmt);
+		vdp_stats.transfers++;
+	}
 	
-	// Update dirty VRAM
-	RECT dec_rect = {SCREEN_WIDTH, 0, 2, VDP_DIRTY_HEIGHT};
+	// Transfer sprite patterns
+	VDP_UploadSprites();
 	
+	// Deconstruct dirty VRAM for the planes
+	// Sprites are only ever drawn from the pattern cache, so raw VRAM isn't transferred
 	uint8_t *vram_dirtyp = vdp_vram_dirty;
 	uint8_t *vram4p = vdp_vram;
 	uint8_t *vram8p = vdp_vram_8;
@@ -518,138 +1028,83 @@ void VDP_Render()
 	{
 		if (*vram_dirtyp)
 		{
-			// Deconstruct VRAM here
-			uint8_t *vram4 = vram4p;
-			uint8_t *vram8 = vram8p;
-			for (size_t j = 0; j < (VDP_DIRTY_HEIGHT * 4); j++)
-			{
-				*vram8p++ = (*vram4p & 0xF0) >> 4;
-				*vram8p++ = (*vram4p & 0x0F) >> 0;
-				vram4p++;
-			}
-			
-			// Transfer to VRAM
-			LoadImage(&dec_rect, (u_long*)vram4);
-			
-			// Clear dirty flag
+			Tile_Unpack(vram8p, vram4p, VDP_DIRTY_HEIGHT * 4);
 			*vram_dirtyp = 0;
 		}
-		else
-		{
-			vram4p += (VDP_DIRTY_HEIGHT * 4);
-			vram8p += (VDP_DIRTY_HEIGHT * 8);
-		}
-		
-		// Move rect
-		if ((dec_rect.y += VDP_DIRTY_HEIGHT) & 0x200)
-		{
-			dec_rect.x += 2;
-			dec_rect.y = 0;
-		}
+		vram4p += (VDP_DIRTY_HEIGHT * 4);
+		vram8p += (VDP_DIRTY_HEIGHT * 8);
 		vram_dirtyp++;
 	}
 	
 	// Update dirty planes
-	ALIGNED4 uint8_t plane[8 * 8];
-	static ALIGNED4 uint8_t plane2[8 * 8] = {};
-	RECT plane_rect = {512, 0, 4, 8};
-	RECT plane2_rect = {768, 0, 4, 8};
-	
-	uint8_t *plane_dirtyp = &vdp_vram_plane_dirty[0][0];
+	// Runs of dirty cells on each row are staged and sent as one transfer per layer
+	static ALIGNED4 uint8_t plane_lo[8][PLANE_WIDTH * 8];
+	static ALIGNED4 uint8_t plane_hi[8][PLANE_WIDTH * 8];
 	
 	for (size_t i = 0; i < 2; i++)
 	{
-		// Update dirty tiles
-		size_t vram_i = i ? vdp_plane_b_location : vdp_plane_a_location;
-		for (size_t j = 0; j < (PLANE_WIDTH * PLANE_HEIGHT); j++)
+		uint8_t *plane_dirtyp = vdp_vram_plane_dirty[i];
+		const uint16_t *tilep = (const uint16_t*)(vdp_vram + (i ? vdp_plane_b_location : vdp_plane_a_location));
+		
+		for (size_t y = 0; y < PLANE_HEIGHT; y++, plane_dirtyp += PLANE_WIDTH, tilep += PLANE_WIDTH)
 		{
-			if (*plane_dirtyp)
+			for (size_t x = 0; x < PLANE_WIDTH;)
 			{
-				// Get tile
-				const uint16_t tile = *((uint16_t*)(vdp_vram + vram_i));
-				uint8_t palette = ((tile & TILE_PALETTE_AND) >> TILE_PALETTE_SHIFT) << 4;
-				uint8_t y_flip = (tile & TILE_Y_FLIP_AND) != 0;
-				uint8_t x_flip = (tile & TILE_X_FLIP_AND) != 0;
-				uint8_t priority = (tile & TILE_PRIORITY_AND) != 0;
-				uint16_t pattern = (tile & TILE_PATTERN_AND) >> TILE_PATTERN_SHIFT;
+				// Find run of dirty cells
+				if (!plane_dirtyp[x])
+				{
+					x++;
+					continue;
+				}
 				
-				// Deconstruct tile
-				uint8_t *patternp = vdp_vram_8 + ((size_t)pattern * 0x40);
-				uint8_t *planep = plane;
+				size_t xa = x;
+				while (x < PLANE_WIDTH && plane_dirtyp[x])
+					plane_dirtyp[x++] = 0;
+				size_t pitch = (x - xa) << 3;
 				
-				if (x_flip)
+				// Deconstruct tiles into the layer their priority belongs to, clearing the other
+				bool any_priority = false;
+				for (size_t j = xa; j < x; j++)
 				{
-					if (y_flip)
-					{
-						for (size_t l = 63; l <= 63; l--)
-							*planep++ = patternp[l] | palette;
-					}
-					else
-					{
-						for (size_t k = 0; k < 8; k++)
-						{
-							for (size_t l = 7; l <= 7; l--)
-								*planep++ = patternp[l] | palette;
-							patternp += 8;
-						}
-					}
-				}
-				else
-				{
-					if (y_flip)
-					{
-						for (signed int l = 56; l >= -56; l -= 16)
-							for (size_t k = 0; k < 8; k++)
-								*planep++ = (patternp++)[l] | palette;
-					}
-					else
-					{
-						for (size_t k = 0; k < 64; k++)
-							*planep++ = *patternp++ | palette;
-					}
+					// Get tile
+					const uint16_t tile = tilep[j];
+					uint8_t palette = ((tile & TILE_PALETTE_AND) >> TILE_PALETTE_SHIFT) << 4;
+					uint8_t y_flip = (tile & TILE_Y_FLIP_AND) != 0;
+					uint8_t x_flip = (tile & TILE_X_FLIP_AND) != 0;
+					uint8_t priority = (tile & TILE_PRIORITY_AND) != 0;
+					uint16_t pattern = (tile & TILE_PATTERN_AND) >> TILE_PATTERN_SHIFT;
+					
+					// Deconstruct tile
+					uint8_t *dst = priority ? &plane_hi[0][0] : &plane_lo[0][0];
+					uint8_t *clr = priority ? &plane_lo[0][0] : &plane_hi[0][0];
+					size_t cell = (j - xa) << 3;
+					
+					Tile_Expand(dst + cell, pitch, vdp_vram_8 + ((size_t)pattern * TILE_SIZE_8), palette, x_flip, y_flip);
+					for (size_t k = 0; k < 8; k++)
+						memset(clr + cell + (k * pitch), 0, 8);
+					
+					any_priority |= priority;
 				}
 				
 				// Transfer to VRAM
-				if (i == 0)
-				{
-					if (priority)
-					{
-						LoadImage(&plane_rect, (u_long*)plane2);
-						LoadImage(&plane2_rect, (u_long*)plane);
-					}
-					else
-					{
-						LoadImage(&plane2_rect, (u_long*)plane2);
-						LoadImage(&plane_rect, (u_long*)plane);
-					}
-				}
-				else
+				// Plane B's high layer is only ever written where it has priority tiles
+				RECT lo_rect = {512 + (xa << 2), ((i * PLANE_HEIGHT) + y) << 3, pitch >> 1, 8};
+				RECT hi_rect = {768 + (xa << 2), ((i * PLANE_HEIGHT) + y) << 3, pitch >> 1, 8};
+				
+				LoadImage(&lo_rect, (u_long*)plane_lo);
+				vdp_stats.transfers++;
+				if (i == 0 || any_priority)
 				{
-					if (priority)
-						LoadImage(&plane2_rect, (u_long*)plane);
-					else
-						LoadImage(&plane_rect, (u_long*)plane);
+					LoadImage(&hi_rect, (u_long*)plane_hi);
+					vdp_stats.transfers++;
 				}
-				
-				// Clear dirty flag
-				*plane_dirtyp = 0;
-			}
-			
-			// Move rect
-			plane_rect.x += 4;
-			plane2_rect.x += 4;
-			if (plane2_rect.x & 0x400)
-			{
-				plane_rect.x = 512;
-				plane_rect.y += 8;
-				plane2_rect.x = 768;
-				plane2_rect.y += 8;
 			}
-			plane_dirtyp++;
-			vram_i += 2;
 		}
 	}
 	
+	PROFILE_END(VDP_VRAM);
+	PROFILE_BEGIN(VDP_Output);
+	
 	// Display screen
 	VSync(0);
 	
@@ -659,6 +1114,9 @@ void VDP_Render()
 	// Draw state
 	DrawOTag(&gpu_statep->ot[GFX_OTLEN]);
 	
+	PROFILE_END(VDP_Output);
+	PROFILE_END(VDP_Render);
+	
 	// Send vertical interrupt
 	vdp_vint();
 }
@@ -13,6 +13,8 @@
 #define PLANE_SIZE   0x2000
 #define SPRITES      80
 #define SPRITES_SIZE (SPRITES * 8)
+#define SPRITES_LINE 20  // Sprites on a line
+#define CELLS_LINE   40  // Sprite cells on a line, 320 pixels
 #define COLOURS      (4 * 16)
 
 // Tile structure
@@ -52,12 +54,39 @@
 #define SPRITE_X_AND   0x1FF
 #define SPRITE_X_SHIFT 0
 
+// VDP statistics, covering the last call to VDP_Render
+typedef struct
+{
+	size_t transfers;  // Image transfers to video memory
+	size_t colours;    // CRAM entries converted
+	size_t patterns;   // Sprite patterns expanded into the cache
+	size_t uncached;   // Sprite cells not drawn because every cache slot was already drawn
+	size_t primitives; // GPU primitives drawn
+	size_t bands;      // Runs of lines sharing a scroll value, over both planes
+	size_t arena;      // Bytes of the primitive buffer used
+	size_t arena_max;  // Most bytes of the primitive buffer used by any frame so far
+	size_t dropped;    // Ordering table layers dropped because the primitive buffer ran out
+	
+	// Counted whether or not the sprite limits are enforced
+	size_t sprite_overflow; // Sprites cut off on at least one line by the sprite limits
+	size_t line_overflow;   // Lines that went over the sprite limits
+} VDP_Stats;
+
+// Sprite limits
+typedef enum
+{
+	VDPSpriteLimit_None, // Every sprite is drawn in full
+	VDPSpriteLimit_Line, // Sprites past SPRITES_LINE on a line, and cells past CELLS_LINE, aren't drawn on it
+} VDPSpriteLimit;
+
 // VDP interface
 int VDP_Init(const MD_Header *header);
 
 void VDP_SeekVRAM(size_t offset);
 void VDP_WriteVRAM(const uint8_t *data, size_t len);
+void VDP_WriteVRAMStrided(const uint8_t *data, size_t len, size_t count, size_t src_stride, size_t dst_stride);
 void VDP_FillVRAM(uint8_t data, size_t len);
+void VDP_WritePlaneRect(size_t location, size_t x, size_t y, size_t w, size_t h, const uint16_t *data);
 
 void VDP_SeekCRAM(size_t offset);
 void VDP_WriteCRAM(const uint16_t *data, size_t len);
@@ -73,3 +102,11 @@ void VDP_SetVScroll(int16_t scroll_a, int16_t scroll_b);
 void VDP_SetHIntPosition(int16_t pos);
 
 void VDP_Render();
+const VDP_Stats *VDP_GetStats();
+
+// Only every 'interval' frames is drawn, or none if it's 0. Frames that aren't drawn still send
+// the vertical interrupt, but don't touch video memory or wait for the display
+void VDP_SetRenderInterval(unsigned int interval);
+
+// Sprites are drawn in full by default, as the limits are only there for the original hardware
+void VDP_SetSpriteLimit(VDPSpriteLimit limit);
@@ -13,9 +13,13 @@
 #include "PaletteCycle.h"
 #include "Nemesis.h"
 #include "PLC.h"
+#include "ArtCache.h"
 #include "Demo.h"
 #include "HUD.h"
 
+#include "Backend/Profile.h"
+#include "Backend/Replay.h"
+
 #include <string.h>
 
 // Title card art
@@ -27,7 +31,18 @@ static const uint8_t art_titlecard[] = {
 // Level gamemode
 void GM_Level()
 {
+	#ifdef SCP_PROFILE
+		// Discard object costs counted outside of the level
+		ObjectCost_Reset();
+	#endif
+	
 	GM_Level_Branch:;
+	#ifdef SCP_PROFILE
+		// Report object costs for the previous attempt at the level, if restarting, and count them again
+		ObjectCost_Report();
+		ObjectCost_Reset();
+	#endif
+	
 	// Set 'title card' flag
 	gamemode |= 0x80;
 	
@@ -43,7 +58,7 @@ void GM_Level()
 	{
 		// Load title card art
 		VDP_SeekVRAM(0xB000);
-		NemDec(art_titlecard);
+		ArtCache_NemDec(art_titlecard);
 		
 		// Load level art and general art
 		if (level_header[LEVEL_ZONE(level_id)].plc1 != 0)
@@ -59,6 +74,7 @@ void GM_Level()
 	pcyc_num = 0;
 	pcyc_time = 0;
 	random_seed.v = 0;
+	Replay_Level(level_id, &random_seed.v);
 	pause = false;
 	hbla_pal = 0;
 	wtr_pos1 = 0;
@@ -227,7 +243,7 @@ void GM_Level()
 			ExecuteObjects();
 			BuildSprites(NULL);
 			RunPLC();
-		} while (objects[4].pos.s.x != objects[4].scratch.u16[4] || plc_buffer[0].art != NULL);
+		} while (objects[4].pos.s.x != objects[4].scratch.u16[4] || PLC_Pending());
 		
 		// Initialize HUD
 		HUD_Base();
@@ -333,11 +349,15 @@ void GM_Level()
 		WaitForVBla();
 		frame_count++;
 		
+		PROFILE_BEGIN(MoveSonicInDemo);
 		MoveSonicInDemo();
+		PROFILE_END(MoveSonicInDemo);
 		// LZWaterFeatures();
 		
 		// Run game
+		PROFILE_BEGIN(ExecuteObjects);
 		ExecuteObjects();
+		PROFILE_END(ExecuteObjects);
 		#ifndef SCP_REV00
 			// Restart level gamemode if restart flag set
 			if (restart)
@@ -346,14 +366,28 @@ void GM_Level()
 		
 		// Setup video and load PLCs
 		if (debug_use || player->routine < 6)
+		{
+			PROFILE_BEGIN(DeformLayers);
 			DeformLayers();
+			PROFILE_END(DeformLayers);
+		}
+		PROFILE_BEGIN(BuildSprites);
 		BuildSprites(NULL);
+		PROFILE_END(BuildSprites);
+		PROFILE_BEGIN(ObjPosLoad);
 		ObjPosLoad();
+		PROFILE_END(ObjPosLoad);
+		PROFILE_BEGIN(PaletteCycle);
 		PaletteCycle();
+		PROFILE_END(PaletteCycle);
+		PROFILE_BEGIN(RunPLC);
 		RunPLC();
+		PROFILE_END(RunPLC);
 		
 		// Other level stuff
+		PROFILE_BEGIN(SynchroAnimate);
 		SynchroAnimate();
+		PROFILE_END(SynchroAnimate);
 		SignpostArtLoad();
 		
 		// Check if level loop should end
@@ -415,4 +449,9 @@ void GM_Level()
 			}
 		}
 	}
+	
+	#ifdef SCP_PROFILE
+		// Report object costs for the level
+		ObjectCost_Report();
+	#endif
 }
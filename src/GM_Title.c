@@ -71,7 +71,7 @@ static void LevelSelect()
 		// Run level select selection and PLCs
 		
 		RunPLC();
-	} while (plc_buffer[0].art != NULL || !(jpad1_press1 & (JPAD_A | JPAD_B | JPAD_C | JPAD_START)));
+	} while (PLC_Pending() || !(jpad1_press1 & (JPAD_A | JPAD_B | JPAD_C | JPAD_START)));
 }
 */
 
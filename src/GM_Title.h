@@ -1,3 +1,9 @@
 #pragma once
 
+#include <stdint.h>
+
+// Title state
+extern uint8_t demo_num;
+
+// Title game mode
 void GM_Title();
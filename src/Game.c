@@ -9,6 +9,13 @@
 #include "Object/Sonic.h"
 #include "PLC.h"
 #include "HUD.h"
+#include "GameState.h"
+
+#include "Backend/Profile.h"
+#include "Backend/Replay.h"
+#ifdef SCP_HOST
+	#include "StateTrace.h"
+#endif
 
 #include "GM_Sega.h"
 #include "GM_Title.h"
@@ -45,17 +52,18 @@ const uint8_t art_text[] = {
 // General game functions
 void ReadJoypads()
 {
-	uint8_t state;
+	// Get joypad states, which are recorded or replaced by a replay
+	uint8_t state1 = Joypad_GetState1();
+	uint8_t state2 = Joypad_GetState2();
+	Replay_Joypad(&state1, &state2);
 	
 	// Read joypad 1
-	state = Joypad_GetState1();
-	jpad1_press1 = state & ~jpad1_hold1;
-	jpad1_hold1 = state;
+	jpad1_press1 = state1 & ~jpad1_hold1;
+	jpad1_hold1 = state1;
 	
 	// Read joypad 2
-	state = Joypad_GetState2();
-	jpad2_press = state & ~jpad2_hold;
-	jpad2_hold = state;
+	jpad2_press = state2 & ~jpad2_hold;
+	jpad2_hold = state2;
 }
 
 // Game entry point
@@ -66,6 +74,12 @@ void EntryPoint()
 	
 	// Initialize game state
 	gamemode = GameMode_Sega;
+	GameState_Register();
+	
+	#ifdef SCP_HOST
+		// Start state tracing, which may start a demo
+		StateTrace_Init();
+	#endif
 	
 	// Run game loop
 	while (1)
@@ -102,9 +116,12 @@ void EntryPoint()
 void WriteVRAMBuffers()
 {
 	// Read joypad state
+	PROFILE_BEGIN(ReadJoypads);
 	ReadJoypads();
+	PROFILE_END(ReadJoypads);
 	
 	// Copy palette
+	PROFILE_BEGIN(CopyBuffers);
 	VDP_SeekCRAM(0);
 	if (wtr_state)
 		VDP_WriteCRAM(&wet_palette[0][0], 0x40);
@@ -116,10 +133,13 @@ void WriteVRAMBuffers()
 	VDP_WriteVRAM((const uint8_t*)sprite_buffer, sizeof(sprite_buffer));
 	VDP_SeekVRAM(VRAM_HSCROLL);
 	VDP_WriteVRAM((const uint8_t*)hscroll_buffer, sizeof(hscroll_buffer));
+	PROFILE_END(CopyBuffers);
 }
 
 void VBlank()
 {
+	PROFILE_BEGIN(VBlank);
+	
 	uint8_t routine = vbla_routine;
 	if (vbla_routine != 0x00)
 	{
@@ -142,16 +162,23 @@ void VBlank()
 			break;
 		case 0x04:
 			WriteVRAMBuffers();
+			PROFILE_BEGIN(LoadTilesAsYouMove);
 			LoadTilesAsYouMove_BGOnly();
+			PROFILE_END(LoadTilesAsYouMove);
+			PROFILE_BEGIN(ProcessDPLC);
 			ProcessDPLC();
+			PROFILE_END(ProcessDPLC);
 			if (demo_length)
 				demo_length--;
 			break;
 		case 0x08:
 			// Read joypad state
+			PROFILE_BEGIN(ReadJoypads);
 			ReadJoypads();
+			PROFILE_END(ReadJoypads);
 			
 			// Copy palette
+			PROFILE_BEGIN(CopyBuffers);
 			VDP_SeekCRAM(0);
 			if (wtr_state)
 				VDP_WriteCRAM(&wet_palette[0][0], 0x40);
@@ -172,6 +199,7 @@ void VBlank()
 				VDP_WriteVRAM(sgfx_buffer, SONIC_DPLC_SIZE);
 				sonframe_chg = false;
 			}
+			PROFILE_END(CopyBuffers);
 			
 			// Copy duplicate plane positions and flags
 			scrpos_x_dup.v     = scrpos_x.v;
@@ -191,14 +219,22 @@ void VBlank()
 			if (hbla_pos >= 96) // Uh?
 			{
 				// Scroll camera
+				PROFILE_BEGIN(LoadTilesAsYouMove);
 				LoadTilesAsYouMove();
+				PROFILE_END(LoadTilesAsYouMove);
 				
 				// Update level animations and HUD
+				PROFILE_BEGIN(AnimateLevelGfx);
 				AnimateLevelGfx();
+				PROFILE_END(AnimateLevelGfx);
+				PROFILE_BEGIN(HUD_Update);
 				HUD_Update();
+				PROFILE_END(HUD_Update);
 				
 				// Process PLCs
+				PROFILE_BEGIN(ProcessDPLC);
 				ProcessDPLC2();
+				PROFILE_END(ProcessDPLC);
 				
 				// Decrement demo timer
 				if (demo_length)
@@ -237,9 +273,12 @@ void VBlank()
 			break;
 		case 0x0C:
 			// Read joypad state
+			PROFILE_BEGIN(ReadJoypads);
 			ReadJoypads();
+			PROFILE_END(ReadJoypads);
 			
 			// Copy palette
+			PROFILE_BEGIN(CopyBuffers);
 			VDP_SeekCRAM(0);
 			if (wtr_state)
 				VDP_WriteCRAM(&wet_palette[0][0], 0x40);
@@ -260,6 +299,7 @@ void VBlank()
 				VDP_WriteVRAM(sgfx_buffer, SONIC_DPLC_SIZE);
 				sonframe_chg = false;
 			}
+			PROFILE_END(CopyBuffers);
 			
 			// Copy duplicate plane positions and flags
 			scrpos_x_dup.v     = scrpos_x.v;
@@ -277,18 +317,28 @@ void VBlank()
 			bg3_scroll_flags_dup = bg3_scroll_flags;
 			
 			// Scroll camera
+			PROFILE_BEGIN(LoadTilesAsYouMove);
 			LoadTilesAsYouMove();
+			PROFILE_END(LoadTilesAsYouMove);
 			
 			// Update level animations and HUD
+			PROFILE_BEGIN(AnimateLevelGfx);
 			AnimateLevelGfx();
+			PROFILE_END(AnimateLevelGfx);
+			PROFILE_BEGIN(HUD_Update);
 			HUD_Update();
+			PROFILE_END(HUD_Update);
 			
 			// Process PLCs
+			PROFILE_BEGIN(ProcessDPLC);
 			ProcessDPLC();
+			PROFILE_END(ProcessDPLC);
 			break;
 		case 0x12:
 			WriteVRAMBuffers();
+			PROFILE_BEGIN(ProcessDPLC);
 			ProcessDPLC();
+			PROFILE_END(ProcessDPLC);
 			break;
 	}
 	
@@ -296,6 +346,8 @@ void VBlank()
 	
 	// Increment VBlank counter
 	vbla_count++;
+	
+	PROFILE_END(VBlank);
 }
 
 void HBlank()
@@ -0,0 +1,227 @@
+#include "GameState.h"
+
+#include "Game.h"
+#include "Demo.h"
+#include "GM_Title.h"
+#include "Video.h"
+#include "Palette.h"
+#include "PaletteCycle.h"
+#include "Level.h"
+#include "LevelDraw.h"
+#include "LevelScroll.h"
+#include "LevelCollision.h"
+#include "SpecialStage.h"
+#include "MathUtil.h"
+#include "Nemesis.h"
+#include "PLC.h"
+#include "Object.h"
+#include "Object/Sonic.h"
+
+#include "Backend/State.h"
+
+// Game state
+static const State_Region game_state[] = {
+	// Game
+	STATE_REGION(buffer0000),
+	STATE_REGION(gamemode),
+	STATE_REGION(demo),
+	STATE_REGION(demo_length),
+	STATE_REGION(credits_num),
+	STATE_REGION(credits_cheat),
+	STATE_REGION(debug_cheat),
+	STATE_REGION(debug_mode),
+	STATE_REGION(jpad2_hold),
+	STATE_REGION(jpad2_press),
+	STATE_REGION(jpad1_hold1),
+	STATE_REGION(jpad1_press1),
+	STATE_REGION(jpad1_hold2),
+	STATE_REGION(jpad1_press2),
+	STATE_REGION(vbla_count),
+	STATE_REGION(btn_pushtime1),
+	STATE_REGION(btn_pushtime2),
+	STATE_REGION(demo_num),
+	STATE_REGION(random_seed),
+	STATE_REGION(nemesis_buffer),
+	
+	// Video
+	STATE_REGION(vbla_routine),
+	STATE_REGION(sprite_count),
+	STATE_REGION(hbla_pal),
+	STATE_REGION(hbla_pos),
+	STATE_REGION(vid_scrpos_y_dup),
+	STATE_REGION(vid_bg_scrpos_y_dup),
+	STATE_REGION(vid_scrpos_x_dup),
+	STATE_REGION(vid_bg_scrpos_x_dup),
+	STATE_REGION(vid_bg3_scrpos_y_dup),
+	STATE_REGION(vid_bg3_scrpos_x_dup),
+	STATE_REGION(sprite_buffer),
+	STATE_REGION(hscroll_buffer),
+	
+	// Palette
+	STATE_REGION(pal_chgspeed),
+	STATE_REGION(dry_palette),
+	STATE_REGION(dry_palette_dup),
+	STATE_REGION(wet_palette),
+	STATE_REGION(wet_palette_dup),
+	STATE_REGION(palette_fade),
+	STATE_REGION(pcyc_num),
+	STATE_REGION(pcyc_time),
+	STATE_REGION(pcyc_buffer),
+	
+	// Level
+	STATE_REGION(level_id),
+	STATE_REGION(dle_routine),
+	STATE_REGION(limit_left1),
+	STATE_REGION(limit_right1),
+	STATE_REGION(limit_top1),
+	STATE_REGION(limit_btm1),
+	STATE_REGION(limit_left2),
+	STATE_REGION(limit_right2),
+	STATE_REGION(limit_top2),
+	STATE_REGION(limit_btm2),
+	STATE_REGION(limit_left3),
+	STATE_REGION(limit_top_db),
+	STATE_REGION(limit_btm_db),
+	STATE_REGION(level_anim),
+	STATE_REGION(last_lamp),
+	STATE_REGION(restart),
+	STATE_REGION(pause),
+	STATE_REGION(time_over),
+	STATE_REGION(frame_count),
+	STATE_REGION(score),
+	STATE_REGION(time),
+	STATE_REGION(rings),
+	STATE_REGION(lives),
+	STATE_REGION(continues),
+	STATE_REGION(score_life),
+	STATE_REGION(air),
+	STATE_REGION(last_special),
+	STATE_REGION(life_num),
+	STATE_REGION(life_count),
+	STATE_REGION(ring_count),
+	STATE_REGION(time_count),
+	STATE_REGION(score_count),
+	STATE_REGION(shield),
+	STATE_REGION(invincibility),
+	STATE_REGION(shoes),
+	STATE_REGION(debug_use),
+	STATE_REGION(wtr_pos1),
+	STATE_REGION(wtr_pos2),
+	STATE_REGION(wtr_pos3),
+	STATE_REGION(water),
+	STATE_REGION(wtr_routine),
+	STATE_REGION(wtr_state),
+	STATE_REGION(level_map16),
+	STATE_REGION(level_layout),
+	STATE_REGION(level_schunks),
+	STATE_REGION(coll_index),
+	STATE_REGION(objects),
+	STATE_REGION(opl_routine),
+	STATE_REGION(opl_screen),
+	STATE_REGION(opl_ptr0),
+	STATE_REGION(opl_ptr4),
+	STATE_REGION(opl_ptr8),
+	STATE_REGION(opl_ptrC),
+	STATE_REGION(objstate_left),
+	STATE_REGION(objstate_right),
+	STATE_REGION(objstate),
+	STATE_REGION(obj31_ypos),
+	STATE_REGION(boss_status),
+	STATE_REGION(lock_screen),
+	STATE_REGION(gfx_big_ring),
+	STATE_REGION(convey_rev),
+	STATE_REGION(obj63),
+	STATE_REGION(tunnel_mode),
+	STATE_REGION(lock_multi),
+	STATE_REGION(tunnel_allow),
+	STATE_REGION(jump_only),
+	STATE_REGION(obj6B),
+	STATE_REGION(lock_ctrl),
+	STATE_REGION(big_ring),
+	STATE_REGION(item_bonus),
+	STATE_REGION(time_bonus),
+	STATE_REGION(ring_bonus),
+	STATE_REGION(endact_bonus),
+	STATE_REGION(sonicend),
+	STATE_REGION(lz_deform),
+	STATE_REGION(f_switch),
+	STATE_REGION(oscillatory),
+	STATE_REGION(sprite_anim),
+	STATE_REGION(sprite_anim_3buf),
+	STATE_REGION(angle_buffer0),
+	STATE_REGION(angle_buffer1),
+	STATE_REGION(scroll_block1_size),
+	STATE_REGION(scroll_block2_size),
+	STATE_REGION(scroll_block3_size),
+	STATE_REGION(scroll_block4_size),
+	
+	// Level scroll
+	STATE_REGION(nobgscroll),
+	STATE_REGION(bgscrollvert),
+	STATE_REGION(fg_scroll_flags),
+	STATE_REGION(bg1_scroll_flags),
+	STATE_REGION(bg2_scroll_flags),
+	STATE_REGION(bg3_scroll_flags),
+	STATE_REGION(fg_scroll_flags_dup),
+	STATE_REGION(bg1_scroll_flags_dup),
+	STATE_REGION(bg2_scroll_flags_dup),
+	STATE_REGION(bg3_scroll_flags_dup),
+	STATE_REGION(scrpos_x),
+	STATE_REGION(scrpos_y),
+	STATE_REGION(bg_scrpos_x),
+	STATE_REGION(bg_scrpos_y),
+	STATE_REGION(bg2_scrpos_x),
+	STATE_REGION(bg2_scrpos_y),
+	STATE_REGION(bg3_scrpos_x),
+	STATE_REGION(bg3_scrpos_y),
+	STATE_REGION(scrpos_x_dup),
+	STATE_REGION(scrpos_y_dup),
+	STATE_REGION(bg_scrpos_x_dup),
+	STATE_REGION(bg_scrpos_y_dup),
+	STATE_REGION(bg2_scrpos_x_dup),
+	STATE_REGION(bg2_scrpos_y_dup),
+	STATE_REGION(bg3_scrpos_x_dup),
+	STATE_REGION(bg3_scrpos_y_dup),
+	STATE_REGION(scrshift_x),
+	STATE_REGION(scrshift_y),
+	STATE_REGION(fg_xblock),
+	STATE_REGION(bg1_xblock),
+	STATE_REGION(bg2_xblock),
+	STATE_REGION(bg3_xblock),
+	STATE_REGION(fg_yblock),
+	STATE_REGION(bg1_yblock),
+	STATE_REGION(bg2_yblock),
+	STATE_REGION(bg3_yblock),
+	STATE_REGION(look_shift),
+	
+	// Sonic
+	STATE_REGION(sonspeed_max),
+	STATE_REGION(sonspeed_acc),
+	STATE_REGION(sonspeed_dec),
+	STATE_REGION(sonframe_num),
+	STATE_REGION(sonframe_chg),
+	STATE_REGION(sgfx_buffer),
+	STATE_REGION(track_sonic),
+	STATE_REGION(track_pos),
+	
+	// Special stage
+	STATE_REGION(ss_angle),
+	STATE_REGION(ss_rotate),
+	STATE_REGION(palss_num),
+	STATE_REGION(palss_time),
+	STATE_REGION(emeralds),
+	STATE_REGION(emerald_list),
+	STATE_REGION(ss_layout),
+};
+
+// Game state interface
+void GameState_Register()
+{
+	// Register game state, then the state private to modules
+	State_Register(game_state, sizeof(game_state) / sizeof(*game_state), NULL);
+	
+	LevelScroll_RegisterState();
+	Object_RegisterState();
+	SS_RegisterState();
+	PLC_RegisterState();
+}
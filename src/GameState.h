@@ -0,0 +1,6 @@
+#pragma once
+
+// Game state interface
+// Registers every mutable game region with the state registry, so the whole game can be saved
+// and loaded with State_Save and State_Load
+void GameState_Register();
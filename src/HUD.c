@@ -7,6 +7,7 @@
 #include "Object/Sonic.h"
 
 #include <stdint.h>
+#include <string.h>
 
 // HUD assets
 static const uint8_t art_hud_num[] = {
@@ -34,6 +35,9 @@ static const uint8_t *hud_cmd_ringbase = &hud_cmd_base[12];
 
 void HUD_WriteCmd(size_t offset, const uint8_t *cmd, size_t cmds)
 {
+	ALIGNED4 uint8_t buffer[16 * 64];
+	uint8_t *bufp = buffer;
+	
 	VDP_SeekVRAM(offset);
 	
 	do
@@ -43,11 +47,19 @@ void HUD_WriteCmd(size_t offset, const uint8_t *cmd, size_t cmds)
 		if (tile >= 0)
 		{
 			const uint8_t *art = art_hud_num + (tile <<= 5);
-			VDP_WriteVRAM(art, 64);
+			memcpy(bufp, art, 64);
 		}
 		else
 		{
-			VDP_FillVRAM(0, 64);
+			memset(bufp, 0, 64);
+		}
+		
+		// Write buffered tiles to VRAM at once
+		bufp += 64;
+		if (bufp == (buffer + sizeof(buffer)) || cmds == 0)
+		{
+			VDP_WriteVRAM(buffer, bufp - buffer);
+			bufp = buffer;
 		}
 	} while (cmds-- > 0);
 }
@@ -3,92 +3,155 @@
 #include "Kosinski.h"
 
 #include <stdbool.h>
+#include <string.h>
 
-static uint16_t descriptor_field;
-static uint32_t descriptor_bits_remaining;
-const uint8_t *source;
+// Decoder
+// The descriptor field is kept in a local rather than fetched by a call per bit, runs of
+// literals are copied together, and matches are copied a word at a time. The source is read
+// in the same order as the original decoder, as a new descriptor field is fetched as soon as
+// the last one is exhausted.
+// When 'safe' is set, every read and write is checked against the given bounds, and NULL is
+// returned if the data is truncated, overflows the destination, or refers to data before it
 
-static void RefreshDescriptorField()
-{
-	descriptor_field = source[0] | (source[1] << 8);
-	source += 2;
-	
-	descriptor_bits_remaining = 16;
-}
+#define KOS_NEED(n) \
+	if (safe && (size_t)(source_end - source) < (size_t)(n)) \
+		return NULL;
 
-static bool GetDescriptorBit()
-{
-	bool bit = descriptor_field & 1;
-	
-	descriptor_field >>= 1;
-	
-	if (--descriptor_bits_remaining == 0)
-		RefreshDescriptorField();
-	
-	return bit;
-}
+#define KOS_BIT(bit) \
+	{ \
+		bit = descriptor & 1; \
+		descriptor >>= 1; \
+		if (--descriptor_bits == 0) \
+		{ \
+			KOS_NEED(2) \
+			descriptor = source[0] | (source[1] << 8); \
+			source += 2; \
+			descriptor_bits = 16; \
+		} \
+	}
 
-uint8_t* KosDec(const uint8_t *_source, void *_destination)
+static inline uint8_t *KosDecMain(const uint8_t *source, size_t source_len, uint8_t *destination, size_t destination_cap, bool safe)
 {
-	source = _source;
-	uint8_t *destination = _destination;
+	const uint8_t *source_end = source + source_len;
+	uint8_t *destination_start = destination;
+	uint8_t *destination_end = destination + destination_cap;
+	
+	uint32_t descriptor;
+	unsigned int descriptor_bits;
 	
-	RefreshDescriptorField();
+	KOS_NEED(2)
+	descriptor = source[0] | (source[1] << 8);
+	source += 2;
+	descriptor_bits = 16;
 	
 	for (;;)
 	{
-		if (GetDescriptorBit())
+		// Count literals, stopping short of the last bit of the field so the next
+		// field is fetched before that literal is read
+		unsigned int literals = 0;
+		while ((descriptor & 1) && literals < descriptor_bits - 1)
+		{
+			descriptor >>= 1;
+			literals++;
+		}
+		
+		if (literals != 0)
+		{
+			descriptor_bits -= literals;
+			
+			KOS_NEED(literals)
+			if (safe && (size_t)(destination_end - destination) < literals)
+				return NULL;
+			
+			memcpy(destination, source, literals);
+			destination += literals;
+			source += literals;
+		}
+		
+		bool bit;
+		KOS_BIT(bit)
+		
+		if (bit)
 		{
+			// Single literal
+			KOS_NEED(1)
+			if (safe && destination == destination_end)
+				return NULL;
 			*destination++ = *source++;
+			continue;
+		}
+		
+		// Match
+		size_t length;
+		size_t distance;
+		
+		KOS_BIT(bit)
+		if (!bit)
+		{
+			// Inline match
+			bool hi, lo;
+			KOS_BIT(hi)
+			KOS_BIT(lo)
+			length = (hi << 1) + lo + 2;
+			
+			KOS_NEED(1)
+			distance = 0x100 - *source++;
 		}
 		else
 		{
-			uint32_t length = 0;
-			int32_t offset;
+			// Full match
+			KOS_NEED(2)
+			uint8_t d0 = *source++;
+			uint8_t d1 = *source++;
 			
-			if (!GetDescriptorBit())
+			distance = 0x2000 - (((d1 & 0xF8) << 5) | d0);
+			length = d1 & 7;
+			
+			if (length != 0)
 			{
-				if (GetDescriptorBit())
-					length += 2;
-				
-				if (GetDescriptorBit())
-					++length;
-				
-				++length;
-				
-				offset = -0x100 + *source++;
+				length += 2;
 			}
 			else
 			{
-				uint8_t d0 = *source++;
-				uint8_t d1 = *source++;
+				KOS_NEED(1)
+				length = *source++;
 				
-				offset = -0x2000 + (((d1 & 0xF8) << 5) | d0);
-				length = d1 & 7;
+				if (length == 0)
+					break;
+				if (length == 1)
+					continue;
 				
-				if (length != 0)
-				{
-					++length;
-				}
-				else
-				{
-					length = *source++;
-					
-					if (length == 0)
-						break;
-					
-					if (length == 1)
-						continue;
-				}
+				length++;
 			}
-			
-			do
+		}
+		
+		if (safe && ((size_t)(destination - destination_start) < distance || (size_t)(destination_end - destination) < length))
+			return NULL;
+		
+		// Copy match, a word at a time if it's far enough back not to overlap the word being written
+		const uint8_t *from = destination - distance;
+		if (distance >= sizeof(uint32_t))
+		{
+			for (; length >= sizeof(uint32_t); length -= sizeof(uint32_t))
 			{
-				*destination = destination[offset];
-				++destination;
-			} while (length-- != 0);
+				memcpy(destination, from, sizeof(uint32_t));
+				destination += sizeof(uint32_t);
+				from += sizeof(uint32_t);
+			}
 		}
+		while (length-- != 0)
+			*destination++ = *from++;
 	}
 	
 	return destination;
 }
+
+uint8_t *KosDec(const uint8_t *source, void *destination)
+{
+	return KosDecMain(source, 0, (uint8_t*)destination, 0, false);
+}
+
+uint8_t *KosDecSafe(const uint8_t *source, size_t source_len, void *destination, size_t destination_cap)
+{
+	return KosDecMain(source, source_len, (uint8_t*)destination, destination_cap, true);
+}
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <stddef.h>
 #include <stdint.h>
 
 uint8_t *KosDec(const uint8_t *source, void *destination);
+uint8_t *KosDecSafe(const uint8_t *source, size_t source_len, void *destination, size_t destination_cap);
@@ -54,13 +54,11 @@ void GetBlockData(const uint8_t **meta, const uint8_t **block, int16_t sx, int16
 
 #define WRITE_TILE(off, xor)                                \
 {                                                           \
-	VDP_SeekVRAM(offset + (off));                           \
-	uint16_t v = ((block[0] << 8) | (block[1] << 0)) ^ xor; \
+	tiles[off] = ((block[0] << 8) | (block[1] << 0)) ^ xor; \
 	block += 2;                                             \
-	VDP_WriteVRAM((const uint8_t*)&v, 2);                   \
 }
 
-void DrawBlock(const uint8_t *meta, const uint8_t *block, size_t offset)
+void DrawBlock(const uint8_t *meta, const uint8_t *block, uint16_t *tiles, size_t pitch)
 {
 	uint8_t flag = meta[0];
 	
@@ -68,32 +66,32 @@ void DrawBlock(const uint8_t *meta, const uint8_t *block, size_t offset)
 	{
 		if (flag & 0x10) // Y flip
 		{
-			WRITE_TILE((PLANE_WIDTH << 1) + 2, 0x1800)
-			WRITE_TILE((PLANE_WIDTH << 1) + 0, 0x1800)
-			WRITE_TILE(                     2, 0x1800)
-			WRITE_TILE(                     0, 0x1800)
+			WRITE_TILE(pitch + 1, 0x1800)
+			WRITE_TILE(pitch + 0, 0x1800)
+			WRITE_TILE(        1, 0x1800)
+			WRITE_TILE(        0, 0x1800)
 		}
 		else
 		{
-			WRITE_TILE(                     2, 0x0800)
-			WRITE_TILE(                     0, 0x0800)
-			WRITE_TILE((PLANE_WIDTH << 1) + 2, 0x0800)
-			WRITE_TILE((PLANE_WIDTH << 1) + 0, 0x0800)
+			WRITE_TILE(        1, 0x0800)
+			WRITE_TILE(        0, 0x0800)
+			WRITE_TILE(pitch + 1, 0x0800)
+			WRITE_TILE(pitch + 0, 0x0800)
 		}
 	}
 	else if (flag & 0x10) // Y flip
 	{
-		WRITE_TILE((PLANE_WIDTH << 1) + 0, 0x1000)
-		WRITE_TILE((PLANE_WIDTH << 1) + 2, 0x1000)
-		WRITE_TILE(                     0, 0x1000)
-		WRITE_TILE(                     2, 0x1000)
+		WRITE_TILE(pitch + 0, 0x1000)
+		WRITE_TILE(pitch + 1, 0x1000)
+		WRITE_TILE(        0, 0x1000)
+		WRITE_TILE(        1, 0x1000)
 	}
 	else
 	{
-		WRITE_TILE(                     0, 0x0000)
-		WRITE_TILE(                     2, 0x0000)
-		WRITE_TILE((PLANE_WIDTH << 1) + 0, 0x0000)
-		WRITE_TILE((PLANE_WIDTH << 1) + 2, 0x0000)
+		WRITE_TILE(        0, 0x0000)
+		WRITE_TILE(        1, 0x0000)
+		WRITE_TILE(pitch + 0, 0x0000)
+		WRITE_TILE(pitch + 1, 0x0000)
 	}
 }
 
@@ -101,14 +99,26 @@ void DrawBlocks_LR_2(size_t offset, size_t pos, int16_t sx, int16_t sy, int16_t
 {
 	const uint8_t *meta;
 	const uint8_t *block;
-	while (width-- > 0)
+	uint16_t tiles[2 * (PLANE_WIDTH << 1)];
+	
+	size_t tx = (pos % (PLANE_WIDTH << 1)) >> 1;
+	size_t ty = pos / (PLANE_WIDTH << 1);
+	
+	while (width > 0)
 	{
-		GetBlockData(&meta, &block, sx, sy, x, y, layout);
-		DrawBlock(meta, block, offset + pos);
-		size_t tx = pos % (PLANE_WIDTH << 1);
-		size_t ty = pos / (PLANE_WIDTH << 1);
-		pos = (ty * (PLANE_WIDTH << 1)) + ((tx + 4) % (PLANE_WIDTH << 1));
-		x += 16;
+		// Draw blocks into a 2 tile high row
+		size_t blocks = (width > PLANE_WIDTH) ? PLANE_WIDTH : width;
+		for (size_t i = 0; i < blocks; i++)
+		{
+			GetBlockData(&meta, &block, sx, sy, x, y, layout);
+			DrawBlock(meta, block, &tiles[i << 1], blocks << 1);
+			x += 16;
+		}
+		
+		// Write row to plane
+		VDP_WritePlaneRect(offset, tx, ty, blocks << 1, 2, tiles);
+		tx = (tx + (blocks << 1)) % PLANE_WIDTH;
+		width -= blocks;
 	}
 }
 
@@ -121,14 +131,26 @@ void DrawBlocks_TB_2(size_t offset, size_t pos, int16_t sx, int16_t sy, int16_t
 {
 	const uint8_t *meta;
 	const uint8_t *block;
-	while (height-- > 0)
+	uint16_t tiles[PLANE_HEIGHT * 2];
+	
+	size_t tx = (pos % (PLANE_WIDTH << 1)) >> 1;
+	size_t ty = pos / (PLANE_WIDTH << 1);
+	
+	while (height > 0)
 	{
-		GetBlockData(&meta, &block, sx, sy, x, y, layout);
-		DrawBlock(meta, block, offset + pos);
-		size_t tx = pos % (PLANE_WIDTH << 1);
-		size_t ty = pos / (PLANE_WIDTH << 1);
-		pos = (((ty + 2) % PLANE_HEIGHT) * (PLANE_WIDTH << 1)) + tx;
-		y += 16;
+		// Draw blocks into a 2 tile wide column
+		size_t blocks = (height > (PLANE_HEIGHT / 2)) ? (PLANE_HEIGHT / 2) : height;
+		for (size_t i = 0; i < blocks; i++)
+		{
+			GetBlockData(&meta, &block, sx, sy, x, y, layout);
+			DrawBlock(meta, block, &tiles[i << 2], 2);
+			y += 16;
+		}
+		
+		// Write column to plane
+		VDP_WritePlaneRect(offset, tx, ty, 2, blocks << 1, tiles);
+		ty = (ty + (blocks << 1)) % PLANE_HEIGHT;
+		height -= blocks;
 	}
 }
 
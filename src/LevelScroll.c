@@ -7,6 +7,8 @@
 
 #include "Object/Sonic.h"
 
+#include "Backend/State.h"
+
 // Level scroll state
 uint8_t nobgscroll, bgscrollvert;
 
@@ -25,6 +27,16 @@ int16_t look_shift;
 
 static ALIGNED4 uint8_t bgscroll_buffer[0x200];
 
+// Level scroll state registration
+static const State_Region bgscroll_state[] = {
+	STATE_REGION(bgscroll_buffer),
+};
+
+void LevelScroll_RegisterState()
+{
+	State_Register(bgscroll_state, sizeof(bgscroll_state) / sizeof(*bgscroll_state), NULL);
+}
+
 // Scroll draw functions
 void BGScroll_Block1(int32_t x, uint8_t bit)
 {
@@ -29,5 +29,6 @@ extern uint8_t fg_yblock, bg1_yblock, bg2_yblock, bg3_yblock;
 extern int16_t look_shift;
 
 // Level scroll functions
+void LevelScroll_RegisterState();
 void BgScrollSpeed(int16_t x, int16_t y);
 void DeformLayers();
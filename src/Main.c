@@ -14,7 +14,8 @@ static const MD_Header s1_header = {
 };
 
 // MegaDrive entry point
-void main()
+int main()
 {
 	MegaDrive_Start(&s1_header);
+	return 0;
 }
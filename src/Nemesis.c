@@ -5,11 +5,24 @@
 #include <stdbool.h>
 #include <stddef.h>
 
+#include "Macros.h"
+
 #include "Backend/VDP.h"
 
-uint8_t nemesis_buffer[0x200];
+uint8_t nemesis_buffer[NEMESIS_BUFFER_SIZE];
 
-void NemDecPrepare(NemesisState *state)
+// Nemesis code lookup
+// Each entry of the table is indexed by the next 8 bits of the stream, and resolves
+// the code at the front of them, along with the code following it if both fit
+typedef struct
+{
+	uint8_t len[2]; // Code lengths (0 for an inline code, or no second code)
+	uint8_t sym[2]; // Run length - 1 in the upper nibble, pixel in the lower nibble
+} NemesisCode;
+
+#define NEMESIS_INLINE 0xFC // Codes starting with 6 set bits are followed by an inline run
+
+static void NemDecPrepareDictionary(NemesisState *state)
 {
 	uint8_t d0;
 	uint8_t d7;
@@ -61,114 +74,177 @@ void NemDecPrepare(NemesisState *state)
 	}
 }
 
-// This function needed a lot of restructuring to look good in C
+static void NemDecPrepareTable(NemesisState *state)
+{
+	const uint8_t *dictionary = state->dictionary;
+	NemesisCode *table = (NemesisCode*)(state->dictionary + NEMESIS_DICT_SIZE);
+	
+	for (size_t i = 0; i < 0x100; i++)
+	{
+		NemesisCode *code = &table[i];
+		code->len[1] = 0;
+		
+		if (i >= NEMESIS_INLINE)
+		{
+			code->len[0] = 0;
+			continue;
+		}
+		
+		uint8_t len = dictionary[i * 2];
+		code->len[0] = len;
+		code->sym[0] = dictionary[i * 2 + 1];
+		
+		// Resolve the following code too if it's entirely within the 8 bits, and no
+		// combination of the unknown bits could make it an inline code
+		if (len == 0 || len >= 8)
+			continue;
+		
+		size_t next = (i << len) & 0xFF;
+		if ((next | ((1 << len) - 1)) >= NEMESIS_INLINE)
+			continue;
+		
+		uint8_t next_len = dictionary[next * 2];
+		if (next_len != 0 && next_len <= 8 - len)
+		{
+			code->len[1] = next_len;
+			code->sym[1] = dictionary[next * 2 + 1];
+		}
+	}
+}
+
+void NemDecPrepare(NemesisState *state)
+{
+	NemDecPrepareDictionary(state);
+	NemDecPrepareTable(state);
+}
+
+// Decoder
+// This keeps the same state as the original 68k decoder between calls, so decoding can be
+// suspended and resumed by the PLC routines, but the bit buffer and row are kept in locals,
+// runs are shifted into rows whole, and VRAM writes are batched by tile
+#define NEMESIS_BATCH 0x200 // Bytes of tiles buffered before being written to VRAM
+
 void NemDecRun(NemesisState *state)
 {
+	// Load state
+	const uint8_t *source = state->source;
+	const NemesisCode *table = (const NemesisCode*)(state->dictionary + NEMESIS_DICT_SIZE);
+	
+	uint32_t bits = state->d5;
+	unsigned int bits_left = state->d6;
+	
+	unsigned int run = state->d0;
+	uint32_t pattern = (state->d1 & 0xF) * 0x11111111;
+	
+	uint32_t row = state->d4;
+	unsigned int row_left = state->d3;
+	uint32_t row_xor = state->d2;
+	uint16_t remaining = state->remaining;
+	
+	ALIGNED4 uint8_t batch[NEMESIS_BATCH];
+	uint8_t *dst = state->vram_mode ? batch : state->destination;
+	
+	const NemesisCode *code = NULL;
+	
 	for (;;)
 	{
-		while (state->d0-- != 0)
+		// Shift the pending run into rows
+		while (run != 0)
 		{
-			state->d4 <<= 4;
-			state->d4 |= state->d1;
+			unsigned int count = (run < row_left) ? run : row_left;
+			if (count == 8)
+				row = pattern;
+			else
+				row = (row << (count * 4)) | (pattern & ((1 << (count * 4)) - 1));
+			run -= count;
 			
-			if (--state->d3 == 0)
+			if ((row_left -= count) == 0)
 			{
+				// Write completed row
+				uint32_t out = row;
 				if (state->xor_mode)
+					out = row_xor ^= row;
+				
+				dst[0] = out >> 24;
+				dst[1] = out >> 16;
+				dst[2] = out >> 8;
+				dst[3] = out;
+				dst += 4;
+				
+				if (--remaining == 0)
+					goto done;
+				
+				if (state->vram_mode && dst == batch + NEMESIS_BATCH)
 				{
-					state->d2 ^= state->d4;
-					
-					if (state->vram_mode)
-					{
-						uint32_t wdw = LESWAP_32(state->d2);
-						VDP_WriteVRAM((const uint8_t*)&wdw, 4);
-					}
-					else
-					{
-						//  NemDec_WriteAndAdvance_XOR
-						*state->destination++ = (state->d2 >> 8 * 3) & 0xFF;
-						*state->destination++ = (state->d2 >> 8 * 2) & 0xFF;
-						*state->destination++ = (state->d2 >> 8 * 1) & 0xFF;
-						*state->destination++ = (state->d2 >> 8 * 0) & 0xFF;
-					}
-				}
-				else
-				{
-					if (state->vram_mode)
-					{
-						uint32_t wdw = LESWAP_32(state->d4);
-						VDP_WriteVRAM((const uint8_t*)&wdw, 4);
-					}
-					else
-					{
-						//  NemDec_WriteAndAdvance
-						*state->destination++ = (state->d4 >> 8 * 3) & 0xFF;
-						*state->destination++ = (state->d4 >> 8 * 2) & 0xFF;
-						*state->destination++ = (state->d4 >> 8 * 1) & 0xFF;
-						*state->destination++ = (state->d4 >> 8 * 0) & 0xFF;
-					}
+					VDP_WriteVRAM(batch, NEMESIS_BATCH);
+					dst = batch;
 				}
 				
-				if (--state->remaining == 0)
-					return;
-				
-				state->d4 = 0;
-				state->d3 = 8;
+				row = 0;
+				row_left = 8;
 			}
 		}
 		
-		size_t index = (state->d5 >> (state->d6 - 8)) & 0xFF;
+		// Take the code following the last one from the same lookup
+		if (code != NULL && code->len[1] != 0)
+		{
+			bits_left -= code->len[1];
+			run = (code->sym[1] >> 4) + 1;
+			pattern = (code->sym[1] & 0xF) * 0x11111111;
+			code = NULL;
+			continue;
+		}
 		
-		if (index < 0xFC)
+		// Read next code
+		if (bits_left < 8)
 		{
-			index *= 2;
-			
-			state->d6 -= state->dictionary[index];
-			
-			if (state->d6 < 9)
-			{
-				state->d6 += 8;
-				
-				state->d5 <<= 8;
-				state->d5 |= *state->source++;
-			}
-			
-			state->d0 = state->d1 = state->dictionary[index + 1];
-			
-			state->d1 &= 0xF;
-			state->d0 &= 0xF0;
+			bits = (bits << 8) | *source++;
+			bits_left += 8;
+		}
+		
+		code = &table[(bits >> (bits_left - 8)) & 0xFF];
+		
+		if (code->len[0] != 0)
+		{
+			bits_left -= code->len[0];
+			run = (code->sym[0] >> 4) + 1;
+			pattern = (code->sym[0] & 0xF) * 0x11111111;
 		}
 		else
 		{
-			state->d6 -= 6;
-			
-			if (state->d6 < 9)
+			// Inline run
+			bits_left -= 6;
+			if (bits_left < 7)
 			{
-				state->d6 += 8;
-				
-				state->d5 <<= 8;
-				state->d5 |= *state->source++;
+				bits = (bits << 8) | *source++;
+				bits_left += 8;
 			}
+			bits_left -= 7;
 			
-			state->d6 -= 7;
-			
-			state->d0 = state->d1 = state->d5 >> state->d6;
-			
-			state->d1 &= 0xF;
-			state->d0 &= 0x70;
-			
-			if (state->d6 < 9)
-			{
-				state->d6 += 8;
-				
-				state->d5 <<= 8;
-				state->d5 |= *state->source++;
-			}
+			uint8_t sym = bits >> bits_left;
+			run = ((sym & 0x70) >> 4) + 1;
+			pattern = (sym & 0xF) * 0x11111111;
+			code = NULL;
 		}
-		
-		state->d0 >>= 4;
-		
-		++state->d0;
 	}
+	
+done:
+	// Flush batched tiles
+	if (state->vram_mode)
+		VDP_WriteVRAM(batch, dst - batch);
+	else
+		state->destination = dst;
+	
+	// Store state
+	state->source = source;
+	state->d5 = bits;
+	state->d6 = bits_left;
+	state->d0 = run;
+	state->d1 = pattern & 0xF;
+	state->d4 = row;
+	state->d3 = 0;
+	state->d2 = row_xor;
+	state->remaining = 0;
 }
 
 static void NemDecMain(NemesisState *state)
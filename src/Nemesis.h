@@ -21,7 +21,12 @@ typedef struct NemesisState
 	uint16_t d6;           //  d6
 } NemesisState;
 
-extern uint8_t nemesis_buffer[0x200];
+// Nemesis buffer, holding the code dictionary followed by the lookup table built from it
+#define NEMESIS_DICT_SIZE   0x200
+#define NEMESIS_TABLE_SIZE  0x400
+#define NEMESIS_BUFFER_SIZE (NEMESIS_DICT_SIZE + NEMESIS_TABLE_SIZE)
+
+extern uint8_t nemesis_buffer[NEMESIS_BUFFER_SIZE];
 
 void NemDecPrepare(NemesisState *state);
 void NemDecRun(NemesisState *state);
@@ -8,6 +8,10 @@
 
 #include "Macros.h"
 
+#include "Backend/Timer.h"
+#include "Backend/State.h"
+
+#include <stdio.h>
 #include <string.h>
 
 // Object draw queue
@@ -59,7 +63,7 @@ void Obj_Newtron(Object *obj);
 void Obj_GHZEdge(Object *obj);
 void Obj_Credits(Object *obj);
 
-static void (*object_func[])(Object*) = {
+static void (*object_func[ObjId_Num])(Object*) = {
 	/* ObjId_Null                */ NULL,
 	/* ObjId_Sonic               */ Obj_Sonic,
 	/* ObjId_02                  */ Obj_Null,
@@ -203,6 +207,16 @@ static void (*object_func[])(Object*) = {
 	/* ObjId_8C                  */ Obj_Null,
 };
 
+// Object state registration
+static const State_Region sprite_queue_state[] = {
+	STATE_REGION(sprite_queue),
+};
+
+void Object_RegisterState()
+{
+	State_Register(sprite_queue_state, sizeof(sprite_queue_state) / sizeof(*sprite_queue_state), NULL);
+}
+
 // Object functions
 Object *FindFreeObj()
 {
@@ -221,12 +235,109 @@ Object *FindNextFreeObj(Object *obj)
 	return NULL; // Original would return the address at the end of object space, I believe
 }
 
+// Object cost accounting
+static ObjectCost object_cost[ObjId_Num];
+static uint32_t object_cost_frames;
+
+#ifdef SCP_PROFILE
+static void ExecuteObject(Object *obj)
+{
+	// Get type before it runs, as it may delete itself
+	ObjectCost *cost = &object_cost[obj->type];
+	uint32_t start = Timer_GetCounter();
+	object_func[obj->type](obj);
+	cost->frame_time += Timer_GetCounter() - start;
+	cost->frame_calls++;
+}
+
+static void ObjectCost_BeginFrame()
+{
+	for (size_t i = 0; i < ObjId_Num; i++)
+	{
+		object_cost[i].frame_calls = 0;
+		object_cost[i].frame_time = 0;
+	}
+}
+
+static void ObjectCost_EndFrame()
+{
+	// Add frame to the totals
+	for (size_t i = 0; i < ObjId_Num; i++)
+	{
+		ObjectCost *cost = &object_cost[i];
+		cost->calls += cost->frame_calls;
+		cost->time += cost->frame_time;
+		if (cost->frame_time > cost->peak_time)
+		{
+			cost->peak_time = cost->frame_time;
+			cost->peak_frame = frame_count;
+		}
+	}
+	object_cost_frames++;
+}
+#else
+#define ExecuteObject(obj) object_func[(obj)->type](obj)
+#define ObjectCost_BeginFrame()
+#define ObjectCost_EndFrame()
+#endif
+
+void ObjectCost_Reset()
+{
+	memset(object_cost, 0, sizeof(object_cost));
+	object_cost_frames = 0;
+}
+
+const ObjectCost *ObjectCost_Get(ObjectId type)
+{
+	return &object_cost[type];
+}
+
+void ObjectCost_Report()
+{
+	// Nothing to report if no frames were counted
+	if (object_cost_frames == 0)
+		return;
+	
+	// Sort the types that were called by time spent
+	uint8_t order[ObjId_Num];
+	size_t types = 0;
+	for (size_t i = 0; i < ObjId_Num; i++)
+	{
+		if (object_cost[i].calls == 0)
+			continue;
+		
+		size_t j = types++;
+		for (; j != 0 && object_cost[order[j - 1]].time < object_cost[i].time; j--)
+			order[j] = order[j - 1];
+		order[j] = i;
+	}
+	
+	// Print report
+	uint32_t rate = Timer_GetCounterRate();
+	printf("Object costs over %lu frames\n", (unsigned long)object_cost_frames);
+	printf("type      calls   total us  avg ns   peak ns  peak frame\n");
+	for (size_t i = 0; i < types; i++)
+	{
+		const ObjectCost *cost = &object_cost[order[i]];
+		printf("%02X   %10lu %10lu %7lu %9lu  %10u\n",
+			(unsigned)order[i],
+			(unsigned long)cost->calls,
+			(unsigned long)(cost->time * 1000000 / rate),
+			(unsigned long)(cost->time / cost->calls * 1000000000 / rate),
+			(unsigned long)((uint64_t)cost->peak_time * 1000000000 / rate),
+			(unsigned)cost->peak_frame);
+	}
+}
+
+// Object execution
 int ExecuteObjects_i;
 
 void ExecuteObjects()
 {
 	Object *obj;
 	
+	ObjectCost_BeginFrame();
+	
 	if (player->routine < 6)
 	{
 		// Run all objects
@@ -235,7 +346,7 @@ void ExecuteObjects()
 		do
 		{
 			if (obj->type)
-				object_func[obj->type](obj);
+				ExecuteObject(obj);
 			obj++;
 		} while (ExecuteObjects_i-- > 0);
 	}
@@ -247,7 +358,7 @@ void ExecuteObjects()
 		do
 		{
 			if (obj->type)
-				object_func[obj->type](obj);
+				ExecuteObject(obj);
 			obj++;
 		} while (ExecuteObjects_i-- > 0);
 		
@@ -260,6 +371,8 @@ void ExecuteObjects()
 			obj++;
 		} while (ExecuteObjects_i-- > 0);
 	}
+	
+	ObjectCost_EndFrame();
 }
 
 // Object drawing
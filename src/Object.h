@@ -155,6 +155,7 @@ typedef enum
 	/*8A*/ ObjId_Credits,
 	/*8B*/ ObjId_8B,
 	/*8C*/ ObjId_8C,
+	ObjId_Num,
 } ObjectId;
 
 // Object types
@@ -268,14 +269,33 @@ typedef struct
 	} scratch;             // Scratch memory
 } Object;
 
+// Object cost accounting
+// When SCP_PROFILE is defined, ExecuteObjects accumulates the calls made to and the time spent in
+// each object type, in Timer_GetCounter counts
+typedef struct
+{
+	uint32_t calls;       // Calls since the last reset
+	uint64_t time;        // Counts spent since the last reset
+	uint32_t frame_calls; // Calls in the last frame
+	uint32_t frame_time;  // Counts spent in the last frame
+	uint32_t peak_time;   // Most counts spent in a single frame
+	uint16_t peak_frame;  // frame_count of that frame
+} ObjectCost;
+
 // Object globals
 extern int ExecuteObjects_i;
 
 // Object functions
+void Object_RegisterState();
+
 Object *FindFreeObj();
 Object *FindNextFreeObj(Object *obj);
 void ExecuteObjects();
 
+void ObjectCost_Reset();
+const ObjectCost *ObjectCost_Get(ObjectId type);
+void ObjectCost_Report();
+
 void BuildSpr_Normal(uint16_t **sprite, uint8_t *sprite_i, uint16_t x, uint16_t y, uint16_t tile, const uint8_t *mappings, uint8_t pieces);
 void BuildSprites(uint8_t *sprite_io);
 
@@ -21,7 +21,7 @@ void Obj_GameOverCard(Object *obj)
 	{
 		case 0: // Initialization
 			// Wait for art to be finished loading
-			if (plc_buffer[0].art != NULL)
+			if (PLC_Pending())
 				break;
 			
 			// Increment routine and set position
@@ -6,13 +6,24 @@
 #include "Object/Sonic.h"
 
 // Monitor assets
-static const uint8_t map_monitor[] = {
-	#include "Resource/Mappings/Monitor.h"
-};
-static const uint8_t anim_monitor[] = {
+// The mappings follow the animations as they do in the original ROM, since the monitors in SBZ2
+// with subtypes past the animation table read their scripts from beyond it. What follows the
+// mappings in the ROM is padded with zeroes, far enough to cover all of those scripts
+#define MONITOR_ANIM_SIZE 130
+#define MONITOR_ASSET_SIZE 0x508
+
+static const uint8_t monitor_assets[MONITOR_ASSET_SIZE] = {
 	#include "Resource/Animation/Monitor.h"
+	,
+	#include "Resource/Mappings/Monitor.h"
+	,
 };
 
+static const uint8_t *const anim_monitor = monitor_assets;
+static const uint8_t *const map_monitor = monitor_assets + MONITOR_ANIM_SIZE;
+
+#define MONITOR_ANIMS 10
+
 // Monitor solid routine
 static signed int Mon_SolidSides(Object *obj, uint16_t x_rad, uint16_t y_rad, int16_t *x_off, int16_t *y_off)
 {
@@ -86,6 +97,11 @@ void Obj_Monitor(Object *obj)
 			// Set collision type and animation
 			obj->col_type = 0x46;
 			obj->anim = obj->scratch.u8[0]; // subtype
+			#ifdef SCP_FIX_BUGS
+				// Show monitors with subtypes that don't have an animation as static monitors
+				if (obj->anim >= MONITOR_ANIMS)
+					obj->anim = 0;
+			#endif
 	// Fallthrough
 		case 2: // Solid
 			switch (obj->routine_sec)
@@ -3,8 +3,17 @@
 #include "PLC.h"
 
 #include "Nemesis.h"
+#include "ArtCache.h"
+#ifdef SCP_PLC_THREAD
+	#include "PLCWorker.h"
+#endif
+
+#include "Game.h"
 
 #include "Backend/VDP.h"
+#include "Backend/Timer.h"
+#include "Backend/Replay.h"
+#include "Backend/State.h"
 
 #include <string.h>
 
@@ -12,6 +21,14 @@
 #define PLC_SPEED_1 9 // How many tiles are loaded per frame during a 'loading' state
 #define PLC_SPEED_2 3 // How many tiles are loaded per frame while the game's running
 
+// With a budget, tiles keep being loaded after the above amounts until the budget is spent
+#ifndef PLC_BUDGET_1
+	#define PLC_BUDGET_1 6000 // Microseconds spent loading tiles per frame during a 'loading' state
+#endif
+#ifndef PLC_BUDGET_2
+	#define PLC_BUDGET_2 1000 // Microseconds spent loading tiles per frame while the game's running
+#endif
+
 // Level art
 const uint8_t art_ghz1[] = {
 	#include "Resource/Art/GHZ1.h"
@@ -549,12 +566,123 @@ static const PLCList *plcs[PlcId_Num] = {
 	/* PlcId_FZBoss      */ NULL,
 };
 
+// PLC priorities
+// Higher priority PLCs are queued ahead of lower priority ones not yet being loaded
+static const PlcPriority plc_priorities[PlcId_Num] = {
+	/* PlcId_Main        */ PlcPriority_Normal,
+	/* PlcId_Main2       */ PlcPriority_Normal,
+	/* PlcId_Explode     */ PlcPriority_High,
+	/* PlcId_GameOver    */ PlcPriority_High,
+	/* PlcId_GHZ         */ PlcPriority_Normal,
+	/* PlcId_GHZ2        */ PlcPriority_Low,
+	/* PlcId_LZ          */ PlcPriority_Normal,
+	/* PlcId_LZ2         */ PlcPriority_Low,
+	/* PlcId_MZ          */ PlcPriority_Normal,
+	/* PlcId_MZ2         */ PlcPriority_Low,
+	/* PlcId_SLZ         */ PlcPriority_Normal,
+	/* PlcId_SLZ2        */ PlcPriority_Low,
+	/* PlcId_SYZ         */ PlcPriority_Normal,
+	/* PlcId_SYZ2        */ PlcPriority_Low,
+	/* PlcId_SBZ         */ PlcPriority_Normal,
+	/* PlcId_SBZ2        */ PlcPriority_Low,
+	/* PlcId_TitleCard   */ PlcPriority_Normal,
+	/* PlcId_Boss        */ PlcPriority_High,
+	/* PlcId_Signpost    */ PlcPriority_Normal,
+	/* PlcId_Warp        */ PlcPriority_Normal,
+	/* PlcId_SpecialStage*/ PlcPriority_Normal,
+	/* PlcId_GHZAnimals  */ PlcPriority_High,
+	/* PlcId_LZAnimals   */ PlcPriority_High,
+	/* PlcId_MZAnimals   */ PlcPriority_High,
+	/* PlcId_SLZAnimals  */ PlcPriority_High,
+	/* PlcId_SYZAnimals  */ PlcPriority_High,
+	/* PlcId_SBZAnimals  */ PlcPriority_High,
+	/* PlcId_SSResult    */ PlcPriority_Normal,
+	/* PlcId_Ending      */ PlcPriority_Normal,
+	/* PlcId_TryAgain    */ PlcPriority_Normal,
+	/* PlcId_EggmanSBZ2  */ PlcPriority_High,
+	/* PlcId_FZBoss      */ PlcPriority_High,
+};
+
 // PLC state
-PLC plc_buffer[16];
+// The buffer is a ring of queued PLCs, the first of which is the one being loaded
+// Queued PLCs are never changed, so they can be matched against new ones, and loading progress is kept in plc_cache_tile
+typedef struct
+{
+	PLC plc;
+	PlcPriority priority;
+} PLCQueued;
+
+static PLCQueued plc_buffer[PLC_BUFFER_SIZE];
+static size_t plc_buffer_head, plc_buffer_count;
+
+#define PLC_FRONT (plc_buffer[plc_buffer_head].plc)
 
 static NemesisState plc_buffer_regs;
 static uint16_t plc_buffer_reg18;
-static uint16_t plc_buffer_reg1A;
+
+static uint32_t plc_budget_1 = PLC_BUDGET_1, plc_budget_2 = PLC_BUDGET_2;
+static PLC_Stats plc_stats;
+
+// Art cache use of the PLC at the front of the buffer
+typedef enum
+{
+	PlcCache_None, // Decompressed straight to VRAM
+	PlcCache_Fill, // Decompressed into the art cache, then copied to VRAM
+	PlcCache_Copy, // Copied from the art cache
+} PlcCache;
+
+static PlcCache plc_cache;
+static size_t plc_cache_tile; // Tiles of the PLC at the front of the buffer already loaded
+
+// PLC queue
+static void PushPLC(const PLC *plc, PlcPriority priority)
+{
+	// Skip art already queued to be loaded to the same place
+	for (size_t i = 0; i < plc_buffer_count; i++)
+	{
+		const PLC *queued = &plc_buffer[(plc_buffer_head + i) % PLC_BUFFER_SIZE].plc;
+		if (queued->art == plc->art && queued->off == plc->off)
+		{
+			plc_stats.duplicates++;
+			return;
+		}
+	}
+	
+	// Drop the PLC if the buffer is full
+	if (plc_buffer_count == PLC_BUFFER_SIZE)
+	{
+		plc_stats.overflows++;
+		return;
+	}
+	
+	// Queue after every PLC of the same or higher priority, and the PLC being loaded
+	size_t pos = plc_buffer_count;
+	size_t first = (plc_buffer_reg18 != 0) ? 1 : 0;
+	while (pos > first && plc_buffer[(plc_buffer_head + pos - 1) % PLC_BUFFER_SIZE].priority < priority)
+	{
+		plc_buffer[(plc_buffer_head + pos) % PLC_BUFFER_SIZE] = plc_buffer[(plc_buffer_head + pos - 1) % PLC_BUFFER_SIZE];
+		pos--;
+	}
+	
+	PLCQueued *queued = &plc_buffer[(plc_buffer_head + pos) % PLC_BUFFER_SIZE];
+	queued->plc = *plc;
+	queued->priority = priority;
+	
+	if (++plc_buffer_count > plc_stats.queue_max)
+		plc_stats.queue_max = plc_buffer_count;
+}
+
+static void PopPLC()
+{
+	// Release the art cache entry of the finished PLC
+	if (plc_cache != PlcCache_None)
+		ArtCache_Release(PLC_FRONT.art, true);
+	plc_cache = PlcCache_None;
+	
+	// Pop the PLC off the buffer so that the next one can be loaded
+	plc_buffer_head = (plc_buffer_head + 1) % PLC_BUFFER_SIZE;
+	plc_buffer_count--;
+}
 
 // PLC interface
 void AddPLC(PlcId plc)
@@ -564,14 +692,9 @@ void AddPLC(PlcId plc)
 	if (list == NULL)
 		return;
 	
-	// Find empty PLC slot
-	PLC *plc_free = plc_buffer;
-	while (plc_free->art != NULL)
-		plc_free++;
-	
 	// Push PLCs to buffer
 	for (size_t i = 0; i < list->plcs; i++)
-		plc_free[i] = list->plc[i];
+		PushPLC(&list->plc[i], plc_priorities[plc]);
 }
 
 void NewPLC(PlcId plc)
@@ -586,22 +709,58 @@ void NewPLC(PlcId plc)
 	
 	// Push PLCs to buffer
 	for (size_t i = 0; i < list->plcs; i++)
-		plc_buffer[i] = list->plc[i];
+		PushPLC(&list->plc[i], plc_priorities[plc]);
 }
 
 void ClearPLC()
 {
+	// Release the art cache entry of the PLC being processed, discarding it if incomplete
+	if (plc_buffer_reg18 != 0 && plc_cache != PlcCache_None)
+		ArtCache_Release(PLC_FRONT.art, plc_cache == PlcCache_Copy);
+#ifdef SCP_PLC_THREAD
+	// Stop the worker thread decompressing it
+	if (plc_buffer_reg18 != 0 && plc_cache != PlcCache_Copy)
+		PLCWorker_Cancel();
+#endif
+	plc_cache = PlcCache_None;
+	
 	// Clear PLC buffer
 	plc_buffer_reg18 = 0;
-	memset(plc_buffer, 0, sizeof(plc_buffer));
+	plc_buffer_head = 0;
+	plc_buffer_count = 0;
+}
+
+bool PLC_Pending()
+{
+	return plc_buffer_count != 0;
 }
 
 void RunPLC()
 {
-	if (plc_buffer[0].art != NULL && plc_buffer_reg18 == 0)
+	if (plc_buffer_count != 0 && plc_buffer_reg18 == 0)
 	{
-		plc_buffer_regs.source = plc_buffer[0].art;
-		plc_buffer_regs.vram_mode = true;
+		const uint8_t *art = PLC_FRONT.art;
+		plc_cache_tile = 0;
+		
+		// Copy art from the art cache if it's there, otherwise try to fill an entry for it
+		if (ArtCache_Find(art, false) != NULL)
+		{
+			ArtCache_Lock(art);
+			plc_cache = PlcCache_Copy;
+			plc_buffer_reg18 = NEM_SIZE(art) / 0x20;
+			return;
+		}
+		plc_cache = (ArtCache_Alloc(art, NEM_SIZE(art)) != NULL) ? PlcCache_Fill : PlcCache_None;
+		
+	#ifdef SCP_PLC_THREAD
+		// Have the worker thread decompress the art
+		plc_buffer_reg18 = NEM_SIZE(art) / 0x20;
+		PLCWorker_Begin(art);
+		return;
+	#endif
+		
+		plc_buffer_regs.source = art;
+		plc_buffer_regs.vram_mode = (plc_cache == PlcCache_None);
 		plc_buffer_regs.dictionary = nemesis_buffer;
 		
 		uint16_t header = (plc_buffer_regs.source[0] << 8) | plc_buffer_regs.source[1];
@@ -622,54 +781,101 @@ void RunPLC()
 	}
 }
 
-static void ProcessDPLC_Main(size_t off)
+static void ProcessDPLC_Main(size_t tiles_min, uint32_t budget)
 {
-	VDP_SeekVRAM(off);
+	uint32_t start = Timer_GetMicros();
+	
+	// Demos and replays use fixed tile counts so they play back the same regardless of speed
+	if (demo != 0 || Replay_Active())
+		budget = 0;
+	
+	VDP_SeekVRAM(PLC_FRONT.off + plc_cache_tile * 0x20);
 	
-	do
+	// Get art cache entry position
+	uint8_t *cache = NULL;
+	if (plc_cache != PlcCache_None)
 	{
-		plc_buffer_regs.remaining = 8;
-		
-		// Inlined NemDec_WriteIter
-		plc_buffer_regs.d3 = 8;
-		plc_buffer_regs.d4 = 0;
-		
-		NemDecRun(&plc_buffer_regs);
-		
-		if (--plc_buffer_reg18 == 0)
+		cache = ArtCache_Find(PLC_FRONT.art, true) + plc_cache_tile * 0x20;
+		if (plc_cache == PlcCache_Fill)
+			plc_buffer_regs.destination = cache;
+	}
+	
+	// Process tiles until at least the minimum amount are loaded and the budget is spent
+	size_t tiles = 0;
+	for (;;)
+	{
+		if (plc_cache == PlcCache_Copy)
 		{
-			// Pop one request off the buffer so that the next one can be filled
-			for (size_t i = 0; i < sizeof(plc_buffer) / sizeof(*plc_buffer) - 1; i++)
-				plc_buffer[i] = plc_buffer[i + 1];
-			return;
+			// Copy tiles from the art cache
+			size_t copy = (tiles_min < plc_buffer_reg18) ? tiles_min : plc_buffer_reg18;
+			VDP_WriteVRAM(cache + tiles * 0x20, copy * 0x20);
+			tiles += copy;
+			plc_buffer_reg18 -= copy;
+		}
+		else
+		{
+		#ifdef SCP_PLC_THREAD
+			// Take the next tile decompressed by the worker thread
+			if (plc_cache == PlcCache_Fill)
+			{
+				PLCWorker_Take(cache + tiles * 0x20);
+			}
+			else
+			{
+				ALIGNED4 uint8_t tile[0x20];
+				PLCWorker_Take(tile);
+				VDP_WriteVRAM(tile, sizeof(tile));
+			}
+		#else
+			plc_buffer_regs.remaining = 8;
+			
+			// Inlined NemDec_WriteIter
+			plc_buffer_regs.d3 = 8;
+			plc_buffer_regs.d4 = 0;
+			
+			NemDecRun(&plc_buffer_regs);
+		#endif
+			tiles++;
+			plc_buffer_reg18--;
 		}
-	} while (--plc_buffer_reg1A != 0);
+		
+		if (plc_buffer_reg18 == 0)
+			break;
+		if (tiles >= tiles_min && (budget == 0 || (uint32_t)(Timer_GetMicros() - start) >= budget))
+			break;
+	}
+	
+	// Copy the tiles decompressed into the art cache
+	if (plc_cache == PlcCache_Fill)
+		VDP_WriteVRAM(cache, tiles * 0x20);
+	plc_cache_tile += tiles;
+	
+	// Update statistics
+	uint32_t time = Timer_GetMicros() - start;
+	plc_stats.frames++;
+	plc_stats.tiles = tiles;
+	plc_stats.tiles_total += tiles;
+	if (tiles > plc_stats.tiles_max)
+		plc_stats.tiles_max = tiles;
+	plc_stats.time = time;
+	plc_stats.time_total += time;
+	if (time > plc_stats.time_max)
+		plc_stats.time_max = time;
+	
+	if (plc_buffer_reg18 == 0)
+		PopPLC();
 }
 
 void ProcessDPLC()
 {
 	if (plc_buffer_reg18 != 0)
-	{
-		plc_buffer_reg1A = PLC_SPEED_1; // Process PLC_SPEED_1 tiles
-		
-		size_t off = plc_buffer[0].off;
-		plc_buffer[0].off += PLC_SPEED_1 * 0x20;
-		
-		ProcessDPLC_Main(off);
-	}
+		ProcessDPLC_Main(PLC_SPEED_1, plc_budget_1);
 }
 
 void ProcessDPLC2()
 {
 	if (plc_buffer_reg18 != 0)
-	{
-		plc_buffer_reg1A = PLC_SPEED_2; // Process PLC_SPEED_2 tiles
-		
-		size_t off = plc_buffer[0].off;
-		plc_buffer[0].off += PLC_SPEED_2 * 0x20;
-		
-		ProcessDPLC_Main(off);
-	}
+		ProcessDPLC_Main(PLC_SPEED_2, plc_budget_2);
 }
 
 void QuickPLC(PlcId plc)
@@ -681,6 +887,69 @@ void QuickPLC(PlcId plc)
 	for (size_t i = 0; i < list->plcs; i++)
 	{
 		VDP_SeekVRAM(list->plc[i].off);
-		NemDec(list->plc[i].art);
+		ArtCache_NemDec(list->plc[i].art);
 	}
 }
+
+void PLC_SetBudget(uint32_t budget_1, uint32_t budget_2)
+{
+	plc_budget_1 = budget_1;
+	plc_budget_2 = budget_2;
+}
+
+const PLC_Stats *PLC_GetStats()
+{
+	return &plc_stats;
+}
+
+// PLC state registration
+static const State_Region plc_state[] = {
+	STATE_REGION(plc_buffer),
+	STATE_REGION(plc_buffer_head),
+	STATE_REGION(plc_buffer_count),
+	STATE_REGION(plc_buffer_regs),
+	STATE_REGION(plc_buffer_reg18),
+	STATE_REGION(plc_cache),
+	STATE_REGION(plc_cache_tile),
+};
+
+static void PLC_LoadState()
+{
+	// The art cache isn't part of the state, so it's started over
+#ifdef SCP_PLC_THREAD
+	PLCWorker_Cancel();
+#endif
+	ArtCache_Flush();
+	
+	PlcCache cache = plc_cache;
+	plc_cache = PlcCache_None;
+	if (plc_buffer_reg18 == 0)
+		return;
+
+#ifndef SCP_PLC_THREAD
+	// Carry on decompressing straight to VRAM
+	if (cache != PlcCache_Copy)
+	{
+		plc_buffer_regs.vram_mode = true;
+		return;
+	}
+#else
+	(void)cache;
+#endif
+	
+	// Start the PLC being loaded over, loading the tiles it had already loaded again
+	size_t tiles = plc_cache_tile;
+	PLC_Stats stats = plc_stats;
+	
+	plc_buffer_reg18 = 0;
+	RunPLC();
+	if (tiles != 0)
+		ProcessDPLC_Main(tiles, 0);
+	
+	plc_stats = stats;
+}
+
+void PLC_RegisterState()
+{
+	State_Register(plc_state, sizeof(plc_state) / sizeof(*plc_state), PLC_LoadState);
+}
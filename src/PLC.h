@@ -1,5 +1,6 @@
 #pragma once
 
+#include <stdbool.h>
 #include <stdint.h>
 #include <stddef.h>
 
@@ -11,7 +12,31 @@ typedef struct
 } PLC;
 
 // PLC buffer
-extern PLC plc_buffer[16];
+#define PLC_BUFFER_SIZE 16
+
+// PLC priorities
+typedef enum
+{
+	PlcPriority_Low,    // Art that isn't needed straight away, such as for objects further into a level
+	PlcPriority_Normal,
+	PlcPriority_High,   // Art needed by objects that can appear at any moment
+} PlcPriority;
+
+// PLC statistics
+// The frame and time statistics cover calls to ProcessDPLC and ProcessDPLC2 that loaded tiles
+typedef struct
+{
+	size_t frames;       // Frames tiles were loaded in
+	size_t tiles;        // Tiles loaded in the last frame
+	size_t tiles_max;    // Most tiles loaded in a frame
+	size_t tiles_total;  // Tiles loaded in total
+	uint32_t time;       // Microseconds spent loading in the last frame
+	uint32_t time_max;   // Most microseconds spent loading in a frame
+	uint64_t time_total; // Microseconds spent loading in total
+	size_t queue_max;    // Most PLCs queued at once
+	size_t duplicates;   // PLCs not queued as the same art was already queued to the same place
+	size_t overflows;    // PLCs dropped as the buffer was full
+} PLC_Stats;
 
 // PLC IDs
 typedef enum
@@ -68,3 +93,12 @@ void RunPLC();
 void ProcessDPLC();
 void ProcessDPLC2();
 void QuickPLC(PlcId plc);
+bool PLC_Pending();
+
+// Loading a state part way through a PLC that was copied from or decompressed by another thread
+// into the art cache loads it again from the start, as the art cache isn't part of the state
+void PLC_RegisterState();
+
+// Budgets are in microseconds per frame, with 0 loading the original fixed tile counts
+void PLC_SetBudget(uint32_t budget_1, uint32_t budget_2);
+const PLC_Stats *PLC_GetStats();
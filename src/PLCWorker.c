@@ -0,0 +1,147 @@
+#include "PLCWorker.h"
+
+#include "Nemesis.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <string.h>
+
+// PLC worker constants
+#define PLC_WORKER_TILES 256 // Tiles that can be decompressed ahead of being taken
+#define PLC_WORKER_TILE  0x20
+
+// Tile ring
+// The worker is the only writer of the write index and the main thread of the read index,
+// so tiles are handed over without locking
+static uint8_t worker_ring[PLC_WORKER_TILES][PLC_WORKER_TILE];
+static size_t worker_ring_write, worker_ring_read;
+
+// Worker state
+static pthread_t worker_thread;
+static pthread_mutex_t worker_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t worker_cond = PTHREAD_COND_INITIALIZER;
+static bool worker_started;
+
+static const uint8_t *worker_art; // Art to decompress next, protected by worker_mutex
+static bool worker_busy;          // Worker is decompressing art
+static bool worker_cancel;        // Worker should stop decompressing its art
+
+static uint8_t worker_dictionary[NEMESIS_BUFFER_SIZE];
+
+#define LOAD(x)     __atomic_load_n(&(x), __ATOMIC_ACQUIRE)
+#define STORE(x, v) __atomic_store_n(&(x), (v), __ATOMIC_RELEASE)
+
+// Worker thread
+static void PLCWorker_Decompress(const uint8_t *art)
+{
+	// Prepare decompression, the same as RunPLC, but with our own dictionary so that
+	// decompression on the main thread isn't disturbed
+	NemesisState state;
+	state.source = art;
+	state.vram_mode = false;
+	state.dictionary = worker_dictionary;
+	
+	uint16_t header = (state.source[0] << 8) | state.source[1];
+	state.source += 2;
+	state.xor_mode = header & 0x8000;
+	size_t tiles = header & 0x7FFF;
+	
+	NemDecPrepare(&state);
+	
+	state.d5 = (state.source[0] << 8) | state.source[1];
+	state.source += 2;
+	state.d0 = 0;
+	state.d1 = 0;
+	state.d2 = 0;
+	state.d6 = 0x10;
+	
+	for (size_t i = 0; i < tiles; i++)
+	{
+		// Wait for room in the ring
+		size_t write = worker_ring_write;
+		while (write - LOAD(worker_ring_read) == PLC_WORKER_TILES)
+		{
+			if (LOAD(worker_cancel))
+				return;
+			sched_yield();
+		}
+		if (LOAD(worker_cancel))
+			return;
+		
+		// Decompress tile and publish it
+		state.destination = worker_ring[write % PLC_WORKER_TILES];
+		state.remaining = 8;
+		state.d3 = 8;
+		state.d4 = 0;
+		NemDecRun(&state);
+		
+		STORE(worker_ring_write, write + 1);
+	}
+}
+
+static void *PLCWorker_Thread(void *arg)
+{
+	(void)arg;
+	
+	for (;;)
+	{
+		// Wait for art to decompress
+		pthread_mutex_lock(&worker_mutex);
+		while (worker_art == NULL)
+			pthread_cond_wait(&worker_cond, &worker_mutex);
+		const uint8_t *art = worker_art;
+		worker_art = NULL;
+		STORE(worker_busy, true);
+		pthread_mutex_unlock(&worker_mutex);
+		
+		PLCWorker_Decompress(art);
+		STORE(worker_busy, false);
+	}
+	
+	return NULL;
+}
+
+// PLC worker interface
+void PLCWorker_Begin(const uint8_t *art)
+{
+	// Start thread
+	if (!worker_started)
+	{
+		pthread_create(&worker_thread, NULL, PLCWorker_Thread, NULL);
+		worker_started = true;
+	}
+	
+	// Hand art to the worker
+	pthread_mutex_lock(&worker_mutex);
+	worker_art = art;
+	pthread_cond_signal(&worker_cond);
+	pthread_mutex_unlock(&worker_mutex);
+}
+
+void PLCWorker_Take(uint8_t *tile)
+{
+	// Wait for the next tile to be decompressed
+	size_t read = worker_ring_read;
+	while (LOAD(worker_ring_write) == read)
+		sched_yield();
+	
+	memcpy(tile, worker_ring[read % PLC_WORKER_TILES], PLC_WORKER_TILE);
+	STORE(worker_ring_read, read + 1);
+}
+
+void PLCWorker_Cancel()
+{
+	// Withdraw art that hasn't been started, and stop any that has
+	pthread_mutex_lock(&worker_mutex);
+	worker_art = NULL;
+	pthread_mutex_unlock(&worker_mutex);
+	
+	STORE(worker_cancel, true);
+	while (LOAD(worker_busy))
+		sched_yield();
+	STORE(worker_cancel, false);
+	
+	// Drop undelivered tiles
+	STORE(worker_ring_read, LOAD(worker_ring_write));
+}
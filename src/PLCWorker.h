@@ -0,0 +1,12 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// PLC worker
+// Decompresses the PLC being loaded on another thread, a tile ahead at a time, while
+// ProcessDPLC only copies the finished tiles out in the same order and amounts as it
+// would've decompressed them
+void PLCWorker_Begin(const uint8_t *art);
+void PLCWorker_Take(uint8_t *tile);
+void PLCWorker_Cancel();
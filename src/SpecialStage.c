@@ -8,6 +8,8 @@
 
 #include "Macros.h"
 
+#include "Backend/State.h"
+
 #include <string.h>
 
 // Special stage layouts
@@ -204,6 +206,17 @@ struct SS_Mapping
 	uint16_t tile;
 } ss_mappings[1 + SS_MAPPINGS];
 
+// Special Stage state registration
+static const State_Region ss_state[] = {
+	STATE_REGION(ss_mappings),
+	STATE_REGION(ss_collected),
+};
+
+void SS_RegisterState()
+{
+	State_Register(ss_state, sizeof(ss_state) / sizeof(*ss_state), NULL);
+}
+
 // Special Stage functions
 void SS_AniWallsRings()
 {
@@ -21,5 +21,7 @@ extern uint8_t emerald_list[8];
 extern uint8_t ss_layout[SS_DIM * SS_DIM];
 
 // Special Stage functions
+void SS_RegisterState();
+
 void SS_ShowLayout(uint8_t sprite_i);
 void SS_Load();
@@ -0,0 +1,385 @@
+#include "StateTrace.h"
+
+#include "Game.h"
+#include "Level.h"
+#include "LevelScroll.h"
+#include "Palette.h"
+#include "SpecialStage.h"
+#include "Constants.h"
+
+#include "Backend/Host/Host.h"
+#include "Backend/State.h"
+#include "Backend/Rewind.h"
+#include "Backend/Timer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+
+// State trace constants
+typedef enum
+{
+	StateField_Objects,
+	StateField_ScrPos,
+	StateField_DryPalette,
+	StateField_PlaneA,
+	StateField_PlaneB,
+	StateField_Num,
+} StateField;
+
+static const char *state_field_name[StateField_Num] = {
+	"objects",
+	"scrpos",
+	"dry_palette",
+	"plane A",
+	"plane B",
+};
+
+#define PLANE_BYTES (PLANE_WIDTH * PLANE_HEIGHT * 2)
+
+// Demos
+static const uint16_t state_intro_demos[] = {
+	LEVEL_ID(ZoneId_GHZ, 0),
+	LEVEL_ID(ZoneId_MZ,  0),
+	LEVEL_ID(ZoneId_SYZ, 0),
+	LEVEL_ID(6, 0), // Special stage
+};
+
+static const uint16_t state_ending_demos[] = {
+	LEVEL_ID(ZoneId_GHZ, 0),
+	LEVEL_ID(ZoneId_MZ,  1),
+	LEVEL_ID(ZoneId_SYZ, 2),
+	LEVEL_ID(ZoneId_LZ,  2),
+	LEVEL_ID(ZoneId_SLZ, 2),
+	LEVEL_ID(ZoneId_SBZ, 0),
+	LEVEL_ID(ZoneId_SBZ, 1),
+	LEVEL_ID(ZoneId_GHZ, 0),
+};
+
+// State trace state
+static FILE *state_trace, *state_check;
+static unsigned long state_frame;
+
+static uint8_t state_demo_mode;
+static bool state_demo_started;
+
+static unsigned long state_loop_save, state_loop_load, state_loop_length;
+static uint8_t *state_loop;
+
+static unsigned long state_rewind_to, state_rewind_at;
+
+// Hashing
+#define FNV_OFFSET 0xCBF29CE484222325ULL
+#define FNV_PRIME  0x100000001B3ULL
+
+static uint64_t StateTrace_Hash(uint64_t hash, const void *data, size_t len)
+{
+	const uint8_t *p = (const uint8_t*)data;
+	while (len-- != 0)
+		hash = (hash ^ *p++) * FNV_PRIME;
+	return hash;
+}
+
+// Memory that objects keep pointers to in their scratch memory
+static const struct
+{
+	const void *base;
+	size_t size;
+} state_regions[] = {
+	{objects,   sizeof(objects)},
+	{ss_layout, sizeof(ss_layout)},
+};
+
+#define STATE_REGIONS (sizeof(state_regions) / sizeof(*state_regions))
+
+static uint64_t StateTrace_HashObjects()
+{
+	// Addresses differ between builds and runs, so the mappings pointer is skipped and any
+	// pointers into the above regions kept in scratch memory are hashed as offsets
+	uint64_t hash = FNV_OFFSET;
+	for (size_t i = 0; i < OBJECTS; i++)
+	{
+		const Object *obj = &objects[i];
+		hash = StateTrace_Hash(hash, obj, offsetof(Object, tile) + sizeof(obj->tile));
+		hash = StateTrace_Hash(hash, &obj->pos, offsetof(Object, scratch) - offsetof(Object, pos));
+		
+		const uint8_t *scratch = obj->scratch.u8;
+		for (size_t j = 0; j < sizeof(obj->scratch);)
+		{
+			uintptr_t value;
+			size_t region = STATE_REGIONS;
+			if (j + sizeof(value) <= sizeof(obj->scratch))
+			{
+				memcpy(&value, scratch + j, sizeof(value));
+				while (region-- != 0)
+					if (value - (uintptr_t)state_regions[region].base <= state_regions[region].size)
+						break;
+			}
+			
+			if (region < STATE_REGIONS)
+			{
+				value = (value - (uintptr_t)state_regions[region].base) * STATE_REGIONS + region;
+				hash = StateTrace_Hash(hash, &value, sizeof(value));
+				j += sizeof(value);
+			}
+			else
+			{
+				hash = StateTrace_Hash(hash, scratch + j, 1);
+				j++;
+			}
+		}
+	}
+	return hash;
+}
+
+static void StateTrace_HashFrame(uint64_t *hash)
+{
+	// Hash state
+	hash[StateField_Objects] = StateTrace_HashObjects();
+	
+	const dword_s *scrpos[] = {
+		&scrpos_x, &scrpos_y,
+		&bg_scrpos_x, &bg_scrpos_y,
+		&bg2_scrpos_x, &bg2_scrpos_y,
+		&bg3_scrpos_x, &bg3_scrpos_y,
+	};
+	hash[StateField_ScrPos] = FNV_OFFSET;
+	for (size_t i = 0; i < sizeof(scrpos) / sizeof(*scrpos); i++)
+		hash[StateField_ScrPos] = StateTrace_Hash(hash[StateField_ScrPos], scrpos[i], sizeof(*scrpos[i]));
+	
+	hash[StateField_DryPalette] = StateTrace_Hash(FNV_OFFSET, dry_palette, sizeof(dry_palette));
+	
+	const uint8_t *vram = VDP_GetVRAM();
+	hash[StateField_PlaneA] = StateTrace_Hash(FNV_OFFSET, vram + VRAM_FG, PLANE_BYTES);
+	hash[StateField_PlaneB] = StateTrace_Hash(FNV_OFFSET, vram + VRAM_BG, PLANE_BYTES);
+}
+
+// Demos
+static void StateTrace_StartDemo(long num)
+{
+	if (num >= 1 && num <= (long)(sizeof(state_intro_demos) / sizeof(*state_intro_demos)))
+	{
+		// Intro demo, set up as the title screen does
+		level_id = state_intro_demos[num - 1];
+		demo = 1;
+		if (level_id != LEVEL_ID(6, 0))
+		{
+			gamemode = GameMode_Demo;
+		}
+		else
+		{
+			gamemode = GameMode_Special;
+			level_id = 0;
+			last_special = 0;
+		}
+	}
+	else if (num <= -1 && num >= -(long)(sizeof(state_ending_demos) / sizeof(*state_ending_demos)))
+	{
+		// Ending demo
+		credits_num = -num;
+		level_id = state_ending_demos[credits_num - 1];
+		demo = -1;
+		gamemode = GameMode_Demo;
+		last_lamp = 0;
+	}
+	else
+	{
+		fprintf(stderr, "Invalid demo %ld\n", num);
+		exit(1);
+	}
+	
+	// Set game state
+	lives = 3;
+	rings = 0;
+	time.pad = time.min = time.sec = time.frame = 0;
+	score = 0;
+	#ifndef SCP_REV00
+		score_life = 5000;
+	#endif
+	
+	state_demo_mode = gamemode;
+}
+
+// State loop
+static void StateTrace_Loop(unsigned long frame)
+{
+	if (frame == state_loop_save)
+	{
+		// Save state
+		state_loop = malloc(State_GetSize());
+		uint32_t start = Timer_GetCounter();
+		if (state_loop == NULL || State_Save(state_loop, State_GetSize()) == 0)
+		{
+			fprintf(stderr, "Failed to save state at frame %lu\n", frame);
+			exit(1);
+		}
+		uint32_t time = Timer_GetCounter() - start;
+		fprintf(stderr, "Saved %lu byte state in %lu us\n", (unsigned long)State_GetSize(),
+			(unsigned long)((uint64_t)time * 1000000 / Timer_GetCounterRate()));
+	}
+	else if (frame == state_loop_load && state_loop != NULL)
+	{
+		// Load state, and again as many frames later
+		if (!State_Load(state_loop, State_GetSize()))
+		{
+			fprintf(stderr, "Failed to load state at frame %lu\n", frame);
+			exit(1);
+		}
+		state_loop_load += state_loop_length;
+	}
+}
+
+// Rewind
+static void StateTrace_Rewind(unsigned long frame)
+{
+	// Push every frame until rewinding
+	if (frame > state_rewind_at)
+		return;
+	Rewind_Push();
+	if (frame != state_rewind_at)
+		return;
+	
+	const Rewind_Stats *stats = Rewind_GetStats();
+	fprintf(stderr, "Rewind history is %lu frames in %lu bytes, about %lu seconds fit (%lu byte deltas and %lu us pushes at most)\n",
+		(unsigned long)stats->frames, (unsigned long)stats->used, (unsigned long)(Rewind_GetCapacity() / 60), (unsigned long)stats->delta_max, (unsigned long)stats->time_max);
+	
+	// Step back to the frame to rewind to
+	for (unsigned long i = frame; i != state_rewind_to; i--)
+	{
+		if (!Rewind_Pop())
+		{
+			fprintf(stderr, "Failed to rewind to frame %lu\n", i - 1);
+			exit(1);
+		}
+	}
+}
+
+// State trace interface
+void StateTrace_Init()
+{
+	// Open trace files
+	const char *trace = getenv("SCP_STATE_TRACE");
+	if (trace != NULL && *trace != '\0' && (state_trace = fopen(trace, "w")) == NULL)
+	{
+		fprintf(stderr, "Failed to open %s\n", trace);
+		exit(1);
+	}
+	
+	const char *check = getenv("SCP_STATE_CHECK");
+	if (check != NULL && *check != '\0' && (state_check = fopen(check, "r")) == NULL)
+	{
+		fprintf(stderr, "Failed to open %s\n", check);
+		exit(1);
+	}
+	
+	// Get state loop
+	// SCP_STATE_LOOP=n,m saves the state at frame n and loads it at frame m, then every m - n
+	// frames after, so frames n to m repeat. Both frames must be within the same game loop
+	const char *loop = getenv("SCP_STATE_LOOP");
+	if (loop != NULL && *loop != '\0')
+	{
+		char *end;
+		state_loop_save = strtoul(loop, &end, 0);
+		state_loop_load = (*end == ',') ? strtoul(end + 1, NULL, 0) : 0;
+		if (state_loop_load <= state_loop_save)
+		{
+			fprintf(stderr, "Invalid state loop %s\n", loop);
+			exit(1);
+		}
+		state_loop_length = state_loop_load - state_loop_save;
+	}
+	
+	// Get rewind
+	// SCP_STATE_REWIND=n,m keeps a rewind history from boot and steps back from frame m to frame n
+	const char *rewind = getenv("SCP_STATE_REWIND");
+	if (rewind != NULL && *rewind != '\0')
+	{
+		char *end;
+		state_rewind_to = strtoul(rewind, &end, 0);
+		state_rewind_at = (*end == ',') ? strtoul(end + 1, NULL, 0) : 0;
+		if (state_rewind_at <= state_rewind_to)
+		{
+			fprintf(stderr, "Invalid rewind %s\n", rewind);
+			exit(1);
+		}
+	}
+	
+	// Start demo
+	const char *demo_num = getenv("SCP_DEMO");
+	if (demo_num != NULL && *demo_num != '\0')
+		StateTrace_StartDemo(strtol(demo_num, NULL, 0));
+}
+
+void StateTrace_Frame()
+{
+	// Stop once the demo we started in has ended
+	// The special stage never leaves its demo, so that one's stopped once the demo timer runs out
+	if (state_demo_mode != 0)
+	{
+		bool running = (gamemode & 0x7F) == state_demo_mode;
+		if (state_demo_mode == GameMode_Special)
+			running = running && demo_length != 0;
+		
+		if (running)
+		{
+			state_demo_started = true;
+		}
+		else if (state_demo_started)
+		{
+			// The trace being compared against must end here too
+			unsigned long expect_frame;
+			if (state_check != NULL && fscanf(state_check, "%lu", &expect_frame) == 1)
+			{
+				fprintf(stderr, "Demo ended after %lu frames, before the state trace\n", state_frame);
+				exit(1);
+			}
+			fprintf(stderr, "Demo ended after %lu frames\n", state_frame);
+			exit(0);
+		}
+	}
+	
+	unsigned long frame = state_frame++;
+	if (state_loop_load != 0)
+		StateTrace_Loop(frame);
+	if (state_rewind_at != 0)
+		StateTrace_Rewind(frame);
+	if (state_trace == NULL && state_check == NULL)
+		return;
+	
+	// Hash frame
+	uint64_t hash[StateField_Num];
+	StateTrace_HashFrame(hash);
+	
+	// Write trace
+	if (state_trace != NULL)
+	{
+		fprintf(state_trace, "%lu", frame);
+		for (size_t i = 0; i < StateField_Num; i++)
+			fprintf(state_trace, " %016llx", (unsigned long long)hash[i]);
+		fprintf(state_trace, "\n");
+	}
+	
+	// Compare against trace
+	if (state_check != NULL)
+	{
+		unsigned long expect_frame;
+		unsigned long long expect[StateField_Num];
+		int read = fscanf(state_check, "%lu %llx %llx %llx %llx %llx", &expect_frame, &expect[0], &expect[1], &expect[2], &expect[3], &expect[4]);
+		if (read != 1 + StateField_Num || expect_frame != frame)
+		{
+			fprintf(stderr, "State trace ended at frame %lu\n", frame);
+			exit(1);
+		}
+		
+		for (size_t i = 0; i < StateField_Num; i++)
+		{
+			if (hash[i] != expect[i])
+			{
+				fprintf(stderr, "State diverged at frame %lu in %s\n", frame, state_field_name[i]);
+				exit(1);
+			}
+		}
+	}
+}
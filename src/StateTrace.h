@@ -0,0 +1,10 @@
+#pragma once
+
+// State tracing
+// Host only. Every frame, hashes of the object table, scroll positions, palette and planes are
+// written to SCP_STATE_TRACE=path, or compared against the trace in SCP_STATE_CHECK=path, exiting
+// at the first frame that differs. SCP_DEMO=n boots straight into intro demo n (1 to 4) or ending
+// demo -n (-1 to -8), exiting once it ends. The special stage demo (4) is stopped once its timer runs out,
+// as the special stage doesn't end its demo yet
+void StateTrace_Init();
+void StateTrace_Frame();
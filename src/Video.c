@@ -4,6 +4,11 @@
 #include "Palette.h"
 #include "LevelScroll.h"
 
+#include "Backend/Profile.h"
+#ifdef SCP_HOST
+	#include "StateTrace.h"
+#endif
+
 #include <string.h>
 
 // Video state
@@ -46,8 +51,18 @@ void VDPSetupGame()
 
 void WaitForVBla()
 {
+	#ifdef SCP_HOST
+		// Trace the state the frame's ended with
+		StateTrace_Frame();
+	#endif
+	
+	// Start new profiler frame
+	PROFILE_FRAME();
+	
 	// Render the VDP
+	PROFILE_BEGIN(WaitForVBla);
 	VDP_Render();
+	PROFILE_END(WaitForVBla);
 }
 
 void ClearScreen()
@@ -71,15 +86,25 @@ void ClearScreen()
 
 void CopyTilemap(const uint8_t *tilemap, size_t offset, size_t width, size_t height)
 {
-	while (height-- > 0)
+	static uint16_t tiles[PLANE_WIDTH * PLANE_HEIGHT];
+	if (width == 0 || height == 0)
+		return;
+	size_t rows_max = (PLANE_WIDTH * PLANE_HEIGHT) / width;
+	
+	while (height > 0)
 	{
-		VDP_SeekVRAM(offset);
-		for (size_t x = 0; x < width; x++)
+		// Convert as many rows as fit
+		size_t rows = (height > rows_max) ? rows_max : height;
+		for (size_t i = 0; i < rows * width; i++)
 		{
-			uint16_t v = (tilemap[0] << 8) | (tilemap[1] << 0);
+			tiles[i] = (tilemap[0] << 8) | (tilemap[1] << 0);
 			tilemap += 2;
-			VDP_WriteVRAM((const uint8_t*)&v, 2);
 		}
-		offset += PLANE_WIDTH * 2;
+		
+		// Write rows to VRAM
+		VDP_SeekVRAM(offset);
+		VDP_WriteVRAMStrided((const uint8_t*)tiles, width << 1, rows, width << 1, PLANE_WIDTH * 2);
+		offset += (PLANE_WIDTH * 2) * rows;
+		height -= rows;
 	}
 }
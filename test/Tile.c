@@ -0,0 +1,128 @@
+// Tile kernel test
+// Checks the tile kernels against their scalar reference implementations over random tiles,
+// with every palette and flip combination, and every Tile_Unpack length up to a few vectors
+// so the remainders the fast paths leave to the portable path are covered
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "Backend/Tile.h"
+
+// Test parameters
+#define TILES 64      // Random tiles tested with each palette and flip combination
+#define UNPACK_LEN 80 // Longest Tile_Unpack length tested
+#define PITCH 13      // Tile_Expand destination pitch, leaving gaps between rows
+#define GUARD 16      // Bytes checked past the end of each output
+
+// Random numbers
+static uint32_t rng_state = 0x12345678;
+
+static uint8_t Rand8()
+{
+	// xorshift32, so the tiles are the same on every platform
+	rng_state ^= rng_state << 13;
+	rng_state ^= rng_state >> 17;
+	rng_state ^= rng_state << 5;
+	return (uint8_t)(rng_state >> 24);
+}
+
+static void RandFill(uint8_t *data, size_t len)
+{
+	for (size_t i = 0; i < len; i++)
+		data[i] = Rand8();
+}
+
+// Tests
+static size_t failures;
+
+static void Check(const char *name, const uint8_t *out, const uint8_t *ref, size_t len, unsigned a, unsigned b)
+{
+	if (memcmp(out, ref, len) == 0)
+		return;
+	if (failures++ < 16)
+		fprintf(stderr, "%s differs from the reference (%u, %u)\n", name, a, b);
+}
+
+static void Test_Unpack()
+{
+	for (size_t len = 0; len <= UNPACK_LEN; len++)
+	{
+		for (size_t i = 0; i < TILES; i++)
+		{
+			uint8_t src[UNPACK_LEN];
+			uint8_t out[UNPACK_LEN * 2 + GUARD], ref[UNPACK_LEN * 2 + GUARD];
+			RandFill(src, len);
+			memset(out, 0xAA, sizeof(out));
+			memset(ref, 0xAA, sizeof(ref));
+			
+			Tile_Unpack(out, src, len);
+			Tile_UnpackRef(ref, src, len);
+			Check("Tile_Unpack", out, ref, len * 2 + GUARD, (unsigned)len, (unsigned)i);
+		}
+	}
+}
+
+static void Test_Expand()
+{
+	for (unsigned palette = 0; palette < 0x100; palette++)
+	{
+		for (unsigned flip = 0; flip < 4; flip++)
+		{
+			for (size_t i = 0; i < TILES; i++)
+			{
+				uint8_t src[TILE_SIZE_8];
+				uint8_t out[PITCH * 8 + GUARD], ref[PITCH * 8 + GUARD];
+				RandFill(src, sizeof(src));
+				memset(out, 0xAA, sizeof(out));
+				memset(ref, 0xAA, sizeof(ref));
+				
+				Tile_Expand(out, PITCH, src, palette, flip & 1, flip & 2);
+				Tile_ExpandRef(ref, PITCH, src, palette, flip & 1, flip & 2);
+				Check("Tile_Expand", out, ref, sizeof(out), palette, flip);
+			}
+		}
+	}
+}
+
+static void Test_ExpandRow()
+{
+	for (unsigned attr = 0; attr < 0x100; attr++)
+	{
+		for (unsigned flip = 0; flip < 2; flip++)
+		{
+			for (size_t i = 0; i < TILES; i++)
+			{
+				uint8_t src[8];
+				uint8_t out[8 + GUARD], ref[8 + GUARD];
+				RandFill(src, sizeof(src));
+				memset(out, 0xAA, sizeof(out));
+				memset(ref, 0xAA, sizeof(ref));
+				
+				Tile_ExpandRow(out, src, attr, flip);
+				Tile_ExpandRowRef(ref, src, attr, flip);
+				Check("Tile_ExpandRow", out, ref, sizeof(out), attr, flip);
+			}
+		}
+	}
+}
+
+// Entry point
+int main()
+{
+	Tile_Init();
+	
+	Test_Unpack();
+	Test_Expand();
+	Test_ExpandRow();
+	
+	if (failures != 0)
+	{
+		fprintf(stderr, "%lu tile kernel checks failed\n", (unsigned long)failures);
+		return 1;
+	}
+	printf("Tile kernels match the reference\n");
+	return 0;
+}